@@ -1,187 +1,229 @@
 #include "buzzer_control.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
-#define LOCAL_LOG_LEVEL ESP_LOG_INFO
-#include "esp_log.h"
-#include "driver/gptimer.h"
-#include <math.h>
+#include "sdkconfig.h"
+#if CONFIG_BUZZER_OUTPUT_LEDC
+#include "driver/ledc.h"
 #include "esp_timer.h"
+#else
+#include "driver/gptimer.h"
+#include "driver/sdm.h"
+#endif
+#include "buzzer_sched.h"
+#include "buzzer_synth.h"
 #include "driver/gpio.h"
-
-#define TIMER_ALARM_COUNT 20
-#define MAX_KEYFRAME_COUNT 32
-#define TASK_N_QUIT (1ULL << 1)
-#define TASK_N_RESET (1ULL << 2)
+#include "event_trace.h"
 
 #define BUZZER_POS_PIN GPIO_NUM_3
 
-#define OUTPUT_PINS (1ULL<<BUZZER_POS_PIN)
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
 
-#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }} 
+#define LEDC_MODE LEDC_LOW_SPEED_MODE
+#define LEDC_TIMER LEDC_TIMER_0
+#define LEDC_CHANNEL LEDC_CHANNEL_0
+#define LEDC_DUTY_RES LEDC_TIMER_10_BIT
+#define LEDC_DUTY_HALF (1 << (LEDC_DUTY_RES - 1))
+#define LEDC_IDLE_FREQ_HZ 1000
 
-#define TIMER_RES 1000000
+#define SDM_SAMPLE_RATE_HZ 1000000
 
-static const char *TAG = "BUZZER_CONTROL";
+// Sequencing state, advanced from the output backend's own timing source rather than a polling task.
+// Submissions only hold play_lock for a few stores, so they never block the calling task.
+static portMUX_TYPE play_lock = portMUX_INITIALIZER_UNLOCKED;
+static buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
 
-static buzzer_pattern_t *current_pattern = NULL;
-static buzzer_keyframe_t *current_keyframe = NULL;
-static TaskHandle_t buzzer_task_handle;
-static int current_keyframe_idx = 0;
-static int64_t next_frame_time_us = 0;
-static uint32_t play_progress = 0;
-static uint32_t play_pos = 0;
-static uint32_t half_period_ticks = 0;
-static bool last_dac_level = 0;
-static bool square_bool[255];
+#if CONFIG_BUZZER_OUTPUT_LEDC
 
-static bool *current_waveform = NULL;
+// The LEDC timer produces the square wave itself, so a keyframe costs a couple of register updates
+// and one timer callback. Waveforms other than square are not available on this backend.
 
-static IRAM_ATTR bool timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_data)
+static esp_timer_handle_t frame_timer;
+static int64_t frame_end_us;
+static bool restart_frame = false;
+
+static void start_frame(const buzzer_keyframe_t *keyframe, int keyframe_idx)
 {
-    bool dac_level = 0;
-    if (current_waveform != NULL && half_period_ticks > 0)
+    event_trace_record(TRACE_BUZZER_FRAME, keyframe_idx, keyframe->frequency);
+
+    if (keyframe->frequency > 0)
     {
-        play_pos = (play_pos + 1) % (half_period_ticks * 2);
-        play_progress = (play_pos * 0xff) / (half_period_ticks * 2);
-        dac_level = current_waveform[play_progress];
+        ledc_set_freq(LEDC_MODE, LEDC_TIMER, keyframe->frequency);
+        ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, LEDC_DUTY_HALF);
     }
-
-    if (dac_level != last_dac_level)
+    else
     {
-        gpio_set_level(BUZZER_POS_PIN, (int)dac_level);
-        last_dac_level = dac_level;
+        ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, 0);
     }
+    ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
 
-    return pdFALSE;
+    // Deadlines chain from the previous one so callback latency does not accumulate into the tempo.
+    frame_end_us += keyframe->duration * 1000;
+    int64_t wait_us = frame_end_us - esp_timer_get_time();
+    esp_timer_start_once(frame_timer, wait_us > 0 ? wait_us : 0);
 }
 
-static void buzzer_set_frequency(uint32_t frequency)
+static void stop_output()
 {
-    half_period_ticks = (TIMER_RES / TIMER_ALARM_COUNT) / (2 * frequency);
+    ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, 0);
+    ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
 }
 
-static void buzzer_start_play(buzzer_waveform_t waveform)
+// The LEDC driver calls can't run inside play_lock, so the keyframe is picked under the lock and
+// applied after it. Only the esp_timer task gets here, which keeps the output updates in order.
+static void frame_timer_cb(void *args)
 {
-    current_waveform = square_bool;
+    const buzzer_keyframe_t *keyframe = NULL;
+
+    portENTER_CRITICAL(&play_lock);
+    if (restart_frame)
+    {
+        restart_frame = false;
+        frame_end_us = esp_timer_get_time();
+        keyframe = buzzer_sched_keyframe(&sched);
+    }
+    else
+    {
+        keyframe = buzzer_sched_next(&sched);
+    }
+    int keyframe_idx = sched.keyframe_idx;
+    portEXIT_CRITICAL(&play_lock);
+
+    if (keyframe != NULL)
+    {
+        start_frame(keyframe, keyframe_idx);
+    }
+    else
+    {
+        stop_output();
+    }
 }
 
-static void buzzer_stop_play()
+// Lane changes are applied by firing the frame timer straight away, so the submitting task never
+// drives the peripheral itself.
+static void output_changed_locked()
 {
-    current_waveform = NULL;
+    restart_frame = true;
 }
 
-static bool increment_pattern_frame()
+static void kick_output()
 {
-    if (current_keyframe == NULL)
-    {
-        return false;
-    }
+    esp_timer_stop(frame_timer);
+    esp_timer_start_once(frame_timer, 0);
+}
 
-    if (esp_timer_get_time() >= next_frame_time_us)
-    {
-        current_keyframe_idx++;
-        if (current_keyframe_idx == current_pattern->frame_count)
-        {
-            current_keyframe_idx = 0;
+static esp_err_t buzzer_output_init()
+{
+    ledc_timer_config_t timer_config = {
+        .speed_mode = LEDC_MODE,
+        .timer_num = LEDC_TIMER,
+        .duty_resolution = LEDC_DUTY_RES,
+        .freq_hz = LEDC_IDLE_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    ERROR_CHECK_RETURN(ledc_timer_config(&timer_config));
+
+    ledc_channel_config_t channel_config = {
+        .gpio_num = BUZZER_POS_PIN,
+        .speed_mode = LEDC_MODE,
+        .channel = LEDC_CHANNEL,
+        .timer_sel = LEDC_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    ERROR_CHECK_RETURN(ledc_channel_config(&channel_config));
 
-            if (!current_pattern->loop)
-            {
-                current_keyframe = NULL;
-                return true;
-            }
-        }
+    esp_timer_create_args_t timer_args = {
+        .callback = frame_timer_cb,
+        .name = "buzzer_frame",
+    };
 
-        current_keyframe = &current_pattern->key_frames[current_keyframe_idx];
+    return esp_timer_create(&timer_args, &frame_timer);
+}
 
-        return true;
-    }
+#else
 
-    return false;
-}
+// Only the ISR touches voice. A lane change under play_lock sets restart_frame instead, and the ISR
+// starts the new keyframe on its next tick.
+static buzzer_voice_t voice;
+static volatile bool restart_frame = false;
+static int8_t last_density = SDM_IDLE_DENSITY;
+static sdm_channel_handle_t sdm_channel;
 
-static void buzzer_play_task(void *args)
+static IRAM_ATTR void start_frame(const buzzer_keyframe_t *keyframe)
 {
-    uint32_t notification = 0;
-    bool changed_keyframe = false;
-    int64_t current_time_us;
+    event_trace_record(TRACE_BUZZER_FRAME, sched.keyframe_idx, keyframe->frequency);
+    buzzer_voice_start_frame(&voice, keyframe, sched.pattern->waveform);
+}
 
-    while (true)
+// Called with play_lock held, starts the keyframe the scheduler is on.
+static IRAM_ATTR void start_current_locked(const buzzer_keyframe_t *keyframe)
+{
+    if (keyframe != NULL)
     {
-        if (xTaskNotifyWait(1, 1, &notification, 10 / portTICK_PERIOD_MS))
-        {
-            if (notification & TASK_N_QUIT)
-            {
-                ESP_LOGI(TAG, "Quitting buzzer loop.");
-                break;
-            }
-
-            if (notification & TASK_N_RESET)
-            {
-                ESP_LOGI(TAG, "Resetting");
-                current_keyframe_idx = 0;
-                if (current_pattern != NULL)
-                {
-                    current_keyframe = &current_pattern->key_frames[0];
-                }
-                else
-                {
-                    current_keyframe = NULL;
-                }
+        start_frame(keyframe);
+    }
+    else
+    {
+        voice.waveform = NULL;
+        voice.frame_ticks_left = 0;
+    }
+}
 
-                next_frame_time_us = 0;
-                changed_keyframe = true;
-            }
-        }
-        else
-        {
-            if (current_pattern != NULL && increment_pattern_frame())
-            {
-                changed_keyframe = true;
-            }
-        }
+static IRAM_ATTR bool timer_isr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_data)
+{
+    int8_t density;
+    bool frame_ended = buzzer_voice_tick(&voice, &density);
 
-        if (changed_keyframe)
-        {
-            buzzer_stop_play();
-            vTaskDelay(10 / portTICK_PERIOD_MS);
+    // The modulator turns the amplitude into pulse density, the buzzer filters that back to a level.
+    if (density != last_density)
+    {
+        sdm_channel_set_pulse_density(sdm_channel, density);
+        last_density = density;
+    }
 
-            current_time_us = esp_timer_get_time();
-            if (current_keyframe != NULL)
-            {
-                next_frame_time_us = current_time_us + current_keyframe->duration * 1000;
+    // Frame boundaries fall on ISR ticks, so note timing is exact to 1 / ISR_RATE_HZ. play_lock is only
+    // taken on the tick that ends a frame or picks up a lane change.
+    if (!frame_ended && !restart_frame)
+    {
+        return pdFALSE;
+    }
 
-                if (current_keyframe->frequency > 0)
-                {
-                    buzzer_set_frequency(current_keyframe->frequency);
-                    buzzer_start_play(current_pattern->waveform);
-                }
-            }
-            changed_keyframe = false;
-        }
+    portENTER_CRITICAL_ISR(&play_lock);
+    if (restart_frame)
+    {
+        restart_frame = false;
+        start_current_locked(buzzer_sched_keyframe(&sched));
+    }
+    else if (sched.pattern != NULL)
+    {
+        start_current_locked(buzzer_sched_next(&sched));
     }
+    portEXIT_CRITICAL_ISR(&play_lock);
 
-    vTaskDelete(NULL);
+    return pdFALSE;
 }
 
-static void gen_approx_wavs()
+// The ISR starts the new keyframe on its next tick.
+static void output_changed_locked()
 {
-    for (int i = 0; i < 255; i++)
-    {
-        square_bool[i] = i > 127 ? 0 : 1;
-    }
+    restart_frame = true;
 }
 
-esp_err_t buzzer_control_init()
+// Nothing left to do, the ISR picks the change up within a tick.
+static void kick_output()
 {
-    gen_approx_wavs();
+}
 
-    gpio_config_t gpio_cfg = {
-        .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = OUTPUT_PINS,
+static esp_err_t buzzer_output_init()
+{
+    sdm_config_t sdm_config = {
+        .clk_src = SDM_CLK_SRC_DEFAULT,
+        .gpio_num = BUZZER_POS_PIN,
+        .sample_rate_hz = SDM_SAMPLE_RATE_HZ,
     };
-
-    ERROR_CHECK_RETURN(gpio_config(&gpio_cfg));
+    ERROR_CHECK_RETURN(sdm_new_channel(&sdm_config, &sdm_channel));
+    ERROR_CHECK_RETURN(sdm_channel_set_pulse_density(sdm_channel, SDM_IDLE_DENSITY));
+    ERROR_CHECK_RETURN(sdm_channel_enable(sdm_channel));
 
     gptimer_config_t config = {
         .clk_src = GPTIMER_CLK_SRC_DEFAULT,
@@ -208,22 +250,83 @@ esp_err_t buzzer_control_init()
     ERROR_CHECK_RETURN(gptimer_set_alarm_action(timer_handle, &alarm_config));
     ERROR_CHECK_RETURN(gptimer_start(timer_handle));
 
-    xTaskCreate(buzzer_play_task, "Buzzer Task", 2048, NULL, 5, &buzzer_task_handle);
-
     return ESP_OK;
 }
 
-esp_err_t buzzer_control_play_pattern(buzzer_pattern_t *pattern)
+#endif
+
+// Called with play_lock held with whether the scheduler changed what is sounding. Returns whether
+// kick_output() is needed.
+static bool lanes_changed(bool changed)
+{
+    if (changed)
+    {
+        output_changed_locked();
+    }
+
+    return changed;
+}
+
+esp_err_t buzzer_control_init()
+{
+    return buzzer_output_init();
+}
+
+esp_err_t buzzer_control_play_pattern(const buzzer_pattern_t *pattern, buzzer_priority_t priority)
 {
-    current_pattern = pattern;
-    xTaskNotify(buzzer_task_handle, TASK_N_RESET, eSetBits);
+    ERROR_CHECK_RETURN(buzzer_sched_check(pattern, priority));
+
+    portENTER_CRITICAL(&play_lock);
+    bool changed = lanes_changed(buzzer_sched_play(&sched, pattern, priority));
+    portEXIT_CRITICAL(&play_lock);
+
+    if (changed)
+    {
+        kick_output();
+    }
 
     return ESP_OK;
 }
 
+esp_err_t buzzer_control_queue_pattern(const buzzer_pattern_t *pattern, buzzer_priority_t priority)
+{
+    ERROR_CHECK_RETURN(buzzer_sched_check(pattern, priority));
+    if (pattern == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool changed;
+    portENTER_CRITICAL(&play_lock);
+    esp_err_t ret = buzzer_sched_queue(&sched, pattern, priority, &changed);
+    lanes_changed(changed);
+    portEXIT_CRITICAL(&play_lock);
+
+    if (changed)
+    {
+        kick_output();
+    }
+
+    return ret;
+}
+
+bool buzzer_control_holds_pattern(const buzzer_pattern_t *pattern)
+{
+    portENTER_CRITICAL(&play_lock);
+    bool held = buzzer_sched_holds(&sched, pattern);
+    portEXIT_CRITICAL(&play_lock);
+
+    return held;
+}
+
 void buzzer_control_deinit()
 {
-    xTaskNotify(buzzer_task_handle, 1, eSetBits);
+    portENTER_CRITICAL(&play_lock);
+    bool changed = lanes_changed(buzzer_sched_clear(&sched));
+    portEXIT_CRITICAL(&play_lock);
 
-    current_pattern = NULL;
+    if (changed)
+    {
+        kick_output();
+    }
 }
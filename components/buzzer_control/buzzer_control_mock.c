@@ -0,0 +1,119 @@
+#include "buzzer_control.h"
+#include "buzzer_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#define LOCAL_LOG_LEVEL ESP_LOG_INFO
+#include "esp_log.h"
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
+
+// Linux target backend with no GPIO or timer. Patterns go through the same lane scheduler as the device, with
+// keyframes timed against the tick count whenever the backend is called rather than by a timer. Lane changes
+// are traced, so replays can line them up with the sensor events that caused them.
+
+static const char *TAG = "BUZZER_CONTROL";
+
+static bool initialized;
+static portMUX_TYPE play_lock = portMUX_INITIALIZER_UNLOCKED;
+static buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
+static TickType_t frame_end;
+
+static TickType_t frame_ticks(const buzzer_keyframe_t *keyframe)
+{
+    TickType_t ticks = pdMS_TO_TICKS(keyframe->duration);
+    return ticks > 0 ? ticks : 1;
+}
+
+// Steps past every keyframe that has ended since the last call. Called with play_lock held.
+static void catch_up()
+{
+    TickType_t now = xTaskGetTickCount();
+    const buzzer_keyframe_t *keyframe = buzzer_sched_keyframe(&sched);
+    while (keyframe != NULL && (int32_t)(now - frame_end) >= 0)
+    {
+        keyframe = buzzer_sched_next(&sched);
+        if (keyframe != NULL)
+        {
+            frame_end += frame_ticks(keyframe);
+        }
+    }
+}
+
+// A lane change starts its keyframe now, as the device backends do. Called with play_lock held.
+static void lanes_changed(bool changed)
+{
+    const buzzer_keyframe_t *keyframe = buzzer_sched_keyframe(&sched);
+    if (changed && keyframe != NULL)
+    {
+        frame_end = xTaskGetTickCount() + frame_ticks(keyframe);
+    }
+}
+
+esp_err_t buzzer_control_init()
+{
+    initialized = true;
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_control_play_pattern(const buzzer_pattern_t *pattern, buzzer_priority_t priority)
+{
+    if (!initialized)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ERROR_CHECK_RETURN(buzzer_sched_check(pattern, priority));
+
+    if (pattern != NULL)
+    {
+        ESP_LOGD(TAG, "play %d frames at priority %d", pattern->frame_count, priority);
+    }
+
+    portENTER_CRITICAL(&play_lock);
+    catch_up();
+    lanes_changed(buzzer_sched_play(&sched, pattern, priority));
+    portEXIT_CRITICAL(&play_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_control_queue_pattern(const buzzer_pattern_t *pattern, buzzer_priority_t priority)
+{
+    if (!initialized)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ERROR_CHECK_RETURN(buzzer_sched_check(pattern, priority));
+    if (pattern == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool changed;
+    portENTER_CRITICAL(&play_lock);
+    catch_up();
+    esp_err_t ret = buzzer_sched_queue(&sched, pattern, priority, &changed);
+    lanes_changed(changed);
+    portEXIT_CRITICAL(&play_lock);
+
+    return ret;
+}
+
+bool buzzer_control_holds_pattern(const buzzer_pattern_t *pattern)
+{
+    portENTER_CRITICAL(&play_lock);
+    catch_up();
+    bool held = buzzer_sched_holds(&sched, pattern);
+    portEXIT_CRITICAL(&play_lock);
+
+    return held;
+}
+
+void buzzer_control_deinit()
+{
+    portENTER_CRITICAL(&play_lock);
+    buzzer_sched_clear(&sched);
+    portEXIT_CRITICAL(&play_lock);
+
+    initialized = false;
+}
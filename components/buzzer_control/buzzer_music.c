@@ -1,9 +1,19 @@
 #include "buzzer_music.h"
 #include "buzzer_control.h"
+#include "buzzer_notes.h"
 #include <string.h>
 #include "esp_log.h"
 
 #define MAX_NOTE_COUNT 512
+#define MAX_OCTAVE (BUZZER_NOTE_OCTAVES - 1)
+#define MAX_NOTE_LEN 64
+#define MIN_TEMPO 16
+#define MAX_TEMPO 960
+#define DEFAULT_TEMPO 240
+#define MAX_DIGITS 4
+#define MAX_DOTS 3
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
 
 typedef enum {
     NOTE_MOD_NONE = 0,
@@ -13,19 +23,7 @@ typedef enum {
 
 static const char* TAG = "BUZZER_MUSIC";
 
-static float note_frequencies[ ] = {
-    16,    17,   18,   19,   20,  21.8,   23, 24.5, 25.9, 27.5, 29.1, 30.8,
-    33,    34,   36,   38,   41,  43.6,   46, 48.9, 51.9,   55, 58.2, 61.7,
-    65,    69,   73,   77,   82,  87.3,   92, 97.9,  103,  110,  116,  123,
-    131,  138,  146,  155,  164,  174,   184,  195,  207,  220,  233,  246,
-    261,  277,  293,  311,  329,  349,   369,  391,  415,  440,  466,  493,
-    523,  554,  587,  622,  659,  698,   739,  783,  830,  880,  932,  987,
-    1046, 1108, 1174, 1244, 1318, 1396, 1479, 1567, 1161, 1760, 1864, 1975,
-    2093, 2217, 2349, 2489, 2637, 2793, 2959, 3135, 3324, 3520, 3729, 3951,
-    4186, 4434, 4698, 4978, 5374, 5587, 5919, 6271, 6644, 7040, 7458, 7902,
-};
-
-static int whole_note_offsets[ ] = {
+static const int whole_note_offsets[ ] = {
     9,  //a
     11, //b
     0,  //c
@@ -35,181 +33,282 @@ static int whole_note_offsets[ ] = {
     7   //g
 };
 
-static float frequency_for_note(char whole, note_mod_t modifier, uint8_t octive) {
-    if (whole < 'a' || whole > 'g') {
-        ESP_LOGE(TAG, "Whole note out of range.");
-        return -1;
+static void buzzer_music_err_idx(const char* music_str, int err_idx) {
+    ESP_LOGE(TAG, "Parse Error: %s\n%*s", music_str, 35 + err_idx, "^");
+}
+
+static esp_err_t parser_fail(buzzer_music_parser_t* parser, esp_err_t err, const char* msg, size_t pos) {
+    parser->err = err;
+    parser->err_msg = msg;
+    parser->err_pos = pos;
+
+    return err;
+}
+
+static esp_err_t emit_frame(buzzer_music_parser_t* parser, uint16_t frequency, uint32_t duration) {
+    if (parser->frame_count == parser->max_frames) {
+        return parser_fail(parser, ESP_ERR_INVALID_SIZE, "Too many notes.", parser->cmd_pos);
+    }
+
+    parser->frames[parser->frame_count++] = (buzzer_keyframe_t){
+        .frequency = frequency,
+        .duration = duration,
+    };
+
+    return ESP_OK;
+}
+
+// Length is in sixteenths of a whole note, which lasts 240000 / tempo ms. Lengths are capped at
+// 2 * MAX_NOTE_LEN first, so this stays within 32 bits.
+static uint32_t duration_ms(const buzzer_music_parser_t* parser, uint32_t sixteenths) {
+    uint32_t dotted = (2u << parser->dots) - 1;
+    return sixteenths * 15000 * dotted / ((uint32_t)parser->tempo << parser->dots);
+}
+
+static esp_err_t finish_note(buzzer_music_parser_t* parser, char whole) {
+    if ((whole == 'c' || whole == 'f') && parser->modifier == NOTE_MOD_FLAT) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "C and F flat are invalid.", parser->cmd_pos);
+    }
+
+    if ((whole == 'e' || whole == 'b') && parser->modifier == NOTE_MOD_SHARP) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "E and B sharp are invalid.", parser->cmd_pos);
     }
 
-    if ((whole == 'c' || whole == 'f') && modifier == NOTE_MOD_FLAT) {
-        ESP_LOGE(TAG, "C and F flat are invalid.");
-        return -1;
+    uint32_t len = parser->digits > 0 ? parser->value : parser->note_len;
+    if (len == 0 || len > MAX_NOTE_LEN) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Note length must be 1-64.", parser->cmd_pos);
     }
 
-    if ((whole == 'e' || whole == 'b') && modifier == NOTE_MOD_SHARP) {
-        ESP_LOGE(TAG, "E and B sharp are invalid.");
-        return -1;
+    uint32_t duration = duration_ms(parser, len);
+    if (duration > UINT16_MAX) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Note too long for the tempo.", parser->cmd_pos);
     }
 
-    int note_idx = whole_note_offsets[whole - 'a'] + modifier + octive * 12;
+    int note_idx = whole_note_offsets[whole - 'a'] + parser->modifier + parser->octave * 12;
 
-    return note_frequencies[note_idx];
+    return emit_frame(parser, note_frequency_hz[note_idx], duration);
 }
 
-static void buzzer_music_err_idx(const char* music_str, int err_idx) {
-    ESP_LOGE(TAG, "Parse Error: %s\n%*s", music_str, 35 + err_idx, "^");
+// Repeats copy the keyframes the block produced, so a change of octave or length inside it applies to
+// every pass the same way.
+static esp_err_t finish_repeat(buzzer_music_parser_t* parser) {
+    if (parser->repeat_depth == 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Repeat end without a start.", parser->cmd_pos);
+    }
+
+    uint32_t count = parser->digits > 0 ? parser->value : 2;
+    if (count == 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Repeat count must be at least 1.", parser->cmd_pos);
+    }
+
+    size_t start = parser->repeat_start[--parser->repeat_depth];
+    size_t block_len = parser->frame_count - start;
+    if (block_len > 0 && (count - 1) > (parser->max_frames - parser->frame_count) / block_len) {
+        return parser_fail(parser, ESP_ERR_INVALID_SIZE, "Too many notes.", parser->cmd_pos);
+    }
+
+    for(uint32_t i=1; i<count; i++) {
+        memcpy(&parser->frames[parser->frame_count], &parser->frames[start], block_len * sizeof(buzzer_keyframe_t));
+        parser->frame_count += block_len;
+    }
+
+    return ESP_OK;
 }
 
-static uint8_t get_note_count(const char* music_str) {
-    int note_count = 0;
-    int len = strlen(music_str);
-    for(int i=0; i<len; i++) {
-        if((music_str[i] >= 'a' && music_str[i] <= 'g') || music_str[i] == 'r') {
-            note_count++;
+// Runs once the character after a command shows it is complete.
+static esp_err_t finish_command(buzzer_music_parser_t* parser) {
+    char cmd = parser->cmd;
+    parser->cmd = 0;
+
+    if (cmd >= 'a' && cmd <= 'g') {
+        return finish_note(parser, cmd);
+    }
+
+    if (cmd == ']') {
+        if (parser->dots > 0) {
+            return parser_fail(parser, ESP_ERR_INVALID_ARG, "Dots only follow notes and rests.", parser->cmd_pos);
         }
+        return finish_repeat(parser);
     }
 
-    return note_count;
-}
+    if (parser->digits == 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Command must have a number following it.", parser->cmd_pos);
+    }
 
-static esp_err_t parse_notes(const char* music_str, buzzer_keyframe_t* frames, int note_count) {
-    int len = strlen(music_str);
-    int8_t octive = 3;
-    int8_t note_len = 1;
-    int idx = 0;
-    uint16_t frame_count = 0;
-
-    while(idx < len) {
-        if (music_str[idx] >= 'a' && music_str[idx] <= 'g') {
-            char whole = music_str[idx];
-            note_mod_t modifier = NOTE_MOD_NONE;
-            if(idx+1 < len) {
-                if(music_str[idx+1] == '#') {
-                    modifier = NOTE_MOD_SHARP;
-                } else if(music_str[idx+1] == '$') {
-                    modifier = NOTE_MOD_FLAT;
-                }
-            }
+    if (cmd != 'r' && parser->dots > 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Dots only follow notes and rests.", parser->cmd_pos);
+    }
 
-            if (frame_count == note_count) {
-                ESP_LOGE(TAG, "Unnexpected note count when parsing.");
-                buzzer_music_err_idx(music_str, idx);
-                return ESP_FAIL;
+    uint32_t value = parser->value;
+    switch (cmd) {
+        case 'r': {
+            if (value == 0 || value > MAX_NOTE_LEN) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Rest length must be 1-64.", parser->cmd_pos);
             }
 
-            float frequency = frequency_for_note(whole, modifier, octive);
-            if (frequency < 0) {
-                ESP_LOGE(TAG, "Failed to parse frequency.");
-                buzzer_music_err_idx(music_str, idx);
+            uint32_t duration = duration_ms(parser, value * 2);
+            if (duration > UINT16_MAX) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Rest too long for the tempo.", parser->cmd_pos);
             }
-
-            frames[frame_count++] = (buzzer_keyframe_t){
-                .duration = note_len * 1000 / 16,
-                .frequency = (uint16_t)frequency,
-            };
-
-            idx++;
-            if (modifier != NOTE_MOD_NONE) {
-                idx++;
+            return emit_frame(parser, 0, duration);
+        }
+        case 'o':
+            if (value > MAX_OCTAVE) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Octave must be 0-8.", parser->cmd_pos);
             }
-        } else if (music_str[idx] == 'o') {
-            octive = -1;
-            char oct_char = music_str[idx+1];
-            if (idx + 1 < len && oct_char > '0' && oct_char < '9') {
-                octive = (int)oct_char - '0';
+            parser->octave = value;
+            return ESP_OK;
+        case 'l':
+            if (value == 0 || value > MAX_NOTE_LEN) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Length must be 1-64.", parser->cmd_pos);
             }
-
-            if (octive < 0) {
-                ESP_LOGE(TAG, "Octive must have an integer following it.");
-                buzzer_music_err_idx(music_str, idx);
-                
-                return ESP_FAIL;
+            parser->note_len = value;
+            return ESP_OK;
+        default:
+            if (value < MIN_TEMPO || value > MAX_TEMPO) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Tempo must be 16-960.", parser->cmd_pos);
             }
+            parser->tempo = value;
+            return ESP_OK;
+    }
+}
 
-            idx += 2;
-        } else if (music_str[idx] == 'l') {
-            note_len = -1;
-            char len_char = music_str[idx+1];
-            if (idx + 1 < len && len_char > '0' && len_char < '9') {
-                note_len = (int)len_char - '0';
-            }
+static esp_err_t feed_char(buzzer_music_parser_t* parser, char c, size_t pos) {
+    if (parser->cmd != 0) {
+        bool is_note = parser->cmd >= 'a' && parser->cmd <= 'g';
 
-            if (note_len < 0) {
-                ESP_LOGE(TAG, "Length must have an integer following it.");
-                buzzer_music_err_idx(music_str, idx);
-                
-                return ESP_FAIL;
+        if (c >= '0' && c <= '9' && parser->dots == 0) {
+            if (parser->digits == MAX_DIGITS) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Number too long.", pos);
             }
+            parser->value = parser->value * 10 + (c - '0');
+            parser->digits++;
+            return ESP_OK;
+        }
 
-            idx += 2;
-        } else if (music_str[idx] == 'r') {
-            uint8_t rest_len = -1;
-            char len_char = music_str[idx+1];
-            if (idx + 1 < len && len_char > '0' && len_char < '9') {
-                rest_len = (int)len_char - '0';
+        if (c == '.') {
+            if (parser->dots == MAX_DOTS) {
+                return parser_fail(parser, ESP_ERR_INVALID_ARG, "Too many dots.", pos);
             }
+            parser->dots++;
+            return ESP_OK;
+        }
 
-            if (rest_len < 0) {
-                ESP_LOGE(TAG, "Rest must have an integer following it.");
-                buzzer_music_err_idx(music_str, idx);
-                
-                return ESP_FAIL;
-            }
+        if (is_note && (c == '#' || c == '$') && parser->modifier == NOTE_MOD_NONE && parser->digits == 0 && parser->dots == 0) {
+            parser->modifier = c == '#' ? NOTE_MOD_SHARP : NOTE_MOD_FLAT;
+            return ESP_OK;
+        }
 
-            frames[frame_count++] = (buzzer_keyframe_t){
-                .duration = rest_len * 1000 / 8,
-                .frequency = 0,
-            };
-
-            idx += 2;
-        } 
-        
-        else {
-            ESP_LOGE(TAG, "Unnexpected character");
-            buzzer_music_err_idx(music_str, idx);
-            return ESP_FAIL;
+        ERROR_CHECK_RETURN(finish_command(parser));
+    }
+
+    if ((c >= 'a' && c <= 'g') || c == 'r' || c == 'o' || c == 'l' || c == 't' || c == ']') {
+        parser->cmd = c;
+        parser->cmd_pos = pos;
+        parser->modifier = NOTE_MOD_NONE;
+        parser->dots = 0;
+        parser->digits = 0;
+        parser->value = 0;
+    } else if (c == '[') {
+        if (parser->repeat_depth == BUZZER_MUSIC_MAX_REPEAT_DEPTH) {
+            return parser_fail(parser, ESP_ERR_INVALID_ARG, "Repeats nested too deep.", pos);
+        }
+        if (parser->repeat_depth == 0) {
+            parser->repeat_pos = pos;
         }
+        parser->repeat_start[parser->repeat_depth++] = parser->frame_count;
+    } else if (c != ' ') {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Unexpected character.", pos);
+    }
+
+    return ESP_OK;
+}
+
+void buzzer_music_parser_init(buzzer_music_parser_t* parser, buzzer_keyframe_t* frames, size_t max_frames) {
+    *parser = (buzzer_music_parser_t){
+        .frames = frames,
+        .max_frames = max_frames,
+        .err = ESP_OK,
+        .tempo = DEFAULT_TEMPO,
+        .octave = 3,
+        .note_len = 1,
+    };
+}
+
+esp_err_t buzzer_music_parser_feed(buzzer_music_parser_t* parser, const char* music, size_t len) {
+    if (parser->err != ESP_OK) {
+        return parser->err;
     }
 
-    if (frame_count != note_count) {
-        ESP_LOGE(TAG, "Unnexpected note count when parsing.");
-        buzzer_music_err_idx(music_str, 0);
-        return ESP_FAIL;
+    for(size_t i=0; i<len; i++) {
+        ERROR_CHECK_RETURN(feed_char(parser, music[i], parser->pos + i));
+    }
+    parser->pos += len;
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_music_parser_finish(buzzer_music_parser_t* parser) {
+    if (parser->err != ESP_OK) {
+        return parser->err;
+    }
+
+    if (parser->cmd != 0) {
+        ERROR_CHECK_RETURN(finish_command(parser));
+    }
+
+    if (parser->repeat_depth > 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "Repeat start without an end.", parser->repeat_pos);
+    }
+
+    if (parser->frame_count == 0) {
+        return parser_fail(parser, ESP_ERR_INVALID_ARG, "No notes to parse.", 0);
     }
 
     return ESP_OK;
 }
 
 esp_err_t buzzer_frequency_sweep(uint16_t start_freq, uint16_t end_freq, uint16_t step_count, uint16_t duration_ms, buzzer_pattern_t** pattern_out) {
-    buzzer_keyframe_t* frames = malloc(sizeof(buzzer_keyframe_t) * step_count);
-    
+    if (step_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    buzzer_pattern_t* pattern;
+    buzzer_keyframe_t* frames;
+    ERROR_CHECK_RETURN(buzzer_pattern_create(step_count, &pattern, &frames));
+
     for(int i=0; i<step_count; i++) {
         frames[i].duration = duration_ms / step_count,
         frames[i].frequency = ((end_freq - start_freq) * i / step_count) + start_freq;
     }
 
-    buzzer_pattern_t* pattern = malloc(sizeof(buzzer_pattern_t));
-    pattern->key_frames = frames;
-    pattern->frame_count = step_count;
-
     *pattern_out = pattern;
 
     return ESP_OK;
 }
 
 esp_err_t parse_music_str(const char* music_str, buzzer_pattern_t** pattern_out) {
-    int note_count = get_note_count(music_str);
-    buzzer_keyframe_t* frames = malloc(sizeof(buzzer_keyframe_t) * note_count);
-
-    if (parse_notes(music_str, frames, note_count) != ESP_OK) {
-        return ESP_FAIL;
+    // The length isn't known until the string has been read, so take what the pool can spare and trim it after.
+    // Every keyframe needs at least one character unless the string repeats, which bounds the reservation.
+    size_t len = strlen(music_str);
+    int max_frames = (memchr(music_str, '[', len) == NULL && len < MAX_NOTE_COUNT) ? len : MAX_NOTE_COUNT;
+
+    buzzer_pattern_t* pattern;
+    buzzer_keyframe_t* frames;
+    ERROR_CHECK_RETURN(buzzer_pattern_reserve(max_frames > 0 ? max_frames : 1, &pattern, &frames));
+
+    buzzer_music_parser_t parser;
+    buzzer_music_parser_init(&parser, frames, pattern->frame_count);
+    buzzer_music_parser_feed(&parser, music_str, len);
+    if (buzzer_music_parser_finish(&parser) != ESP_OK) {
+        ESP_LOGE(TAG, "%s", parser.err_msg);
+        buzzer_music_err_idx(music_str, parser.err_pos);
+        buzzer_pattern_destroy(pattern);
+        return parser.err;
     }
 
-    buzzer_pattern_t* pattern = malloc(sizeof(buzzer_pattern_t));
-    pattern->key_frames = frames;
-    pattern->frame_count = note_count;
-
+    buzzer_pattern_shrink(pattern, parser.frame_count);
     *pattern_out = pattern;
 
     return ESP_OK;
-}
\ No newline at end of file
+}
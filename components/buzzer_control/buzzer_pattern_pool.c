@@ -0,0 +1,170 @@
+#include "buzzer_pattern_pool.h"
+#include "buzzer_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#define FRAME_BLOCK_LEN 8
+#define FRAME_BLOCK_COUNT ((CONFIG_BUZZER_PATTERN_POOL_FRAMES + FRAME_BLOCK_LEN - 1) / FRAME_BLOCK_LEN)
+#define BLOCK_FREE 0
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
+
+static buzzer_pattern_t patterns[CONFIG_BUZZER_PATTERN_POOL_PATTERNS];
+static buzzer_keyframe_t frames[FRAME_BLOCK_COUNT * FRAME_BLOCK_LEN];
+
+// Each block records which slot holds it (slot index + 1), so destroy does not trust fields the caller can edit.
+static uint8_t block_owner[FRAME_BLOCK_COUNT];
+static bool slot_used[CONFIG_BUZZER_PATTERN_POOL_PATTERNS];
+static size_t blocks_used = 0;
+static size_t slots_used = 0;
+
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Returns the start of the first free run of max_blocks, or else of the longest shorter one, with its length
+// in run_out. Blocks are small enough that this is one short scan.
+static int find_free_run(int max_blocks, int* run_out) {
+    int best_start = -1;
+    int best_run = 0;
+    int run = 0;
+    for(int i=0; i<FRAME_BLOCK_COUNT; i++) {
+        run = block_owner[i] == BLOCK_FREE ? run + 1 : 0;
+        if (run > best_run) {
+            best_run = run;
+            best_start = i - run + 1;
+            if (run == max_blocks) {
+                break;
+            }
+        }
+    }
+
+    *run_out = best_run;
+    return best_start;
+}
+
+// Claims a slot and between min_blocks and max_blocks contiguous blocks, as many as are free.
+static esp_err_t claim(int min_blocks, int max_blocks, buzzer_pattern_t** pattern_out, buzzer_keyframe_t** frames_out) {
+    if (min_blocks > FRAME_BLOCK_COUNT) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&pool_lock);
+    int slot = -1;
+    for(int i=0; i<CONFIG_BUZZER_PATTERN_POOL_PATTERNS; i++) {
+        if (!slot_used[i]) {
+            slot = i;
+            break;
+        }
+    }
+
+    int block_count = 0;
+    int first_block = slot < 0 ? -1 : find_free_run(max_blocks, &block_count);
+    if (first_block < 0 || block_count < min_blocks) {
+        portEXIT_CRITICAL(&pool_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    slot_used[slot] = true;
+    slots_used++;
+    for(int i=first_block; i<first_block + block_count; i++) {
+        block_owner[i] = slot + 1;
+    }
+    blocks_used += block_count;
+    portEXIT_CRITICAL(&pool_lock);
+
+    buzzer_keyframe_t* pattern_frames = &frames[first_block * FRAME_BLOCK_LEN];
+    patterns[slot] = (buzzer_pattern_t){
+        .loop = false,
+        .frame_count = block_count * FRAME_BLOCK_LEN,
+        .waveform = BUZZER_WAV_SQUARE,
+        .key_frames = pattern_frames,
+    };
+
+    *pattern_out = &patterns[slot];
+    *frames_out = pattern_frames;
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_pattern_create(int frame_count, buzzer_pattern_t** pattern_out, buzzer_keyframe_t** frames_out) {
+    if (frame_count <= 0 || pattern_out == NULL || frames_out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int block_count = (frame_count + FRAME_BLOCK_LEN - 1) / FRAME_BLOCK_LEN;
+    ERROR_CHECK_RETURN(claim(block_count, block_count, pattern_out, frames_out));
+    (*pattern_out)->frame_count = frame_count;
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_pattern_reserve(int max_frames, buzzer_pattern_t** pattern_out, buzzer_keyframe_t** frames_out) {
+    if (max_frames <= 0 || pattern_out == NULL || frames_out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ERROR_CHECK_RETURN(claim(1, (max_frames + FRAME_BLOCK_LEN - 1) / FRAME_BLOCK_LEN, pattern_out, frames_out));
+    if ((*pattern_out)->frame_count > max_frames) {
+        (*pattern_out)->frame_count = max_frames;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_pattern_shrink(buzzer_pattern_t* pattern, int frame_count) {
+    if (pattern < patterns || pattern >= patterns + CONFIG_BUZZER_PATTERN_POOL_PATTERNS || frame_count <= 0 || frame_count > pattern->frame_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int slot = pattern - patterns;
+    int keep_blocks = (frame_count + FRAME_BLOCK_LEN - 1) / FRAME_BLOCK_LEN;
+    int first_block = (pattern->key_frames - frames) / FRAME_BLOCK_LEN;
+
+    portENTER_CRITICAL(&pool_lock);
+    for(int i=first_block + keep_blocks; i<FRAME_BLOCK_COUNT && block_owner[i] == slot + 1; i++) {
+        block_owner[i] = BLOCK_FREE;
+        blocks_used--;
+    }
+    portEXIT_CRITICAL(&pool_lock);
+
+    pattern->frame_count = frame_count;
+
+    return ESP_OK;
+}
+
+esp_err_t buzzer_pattern_destroy(buzzer_pattern_t* pattern) {
+    if (pattern < patterns || pattern >= patterns + CONFIG_BUZZER_PATTERN_POOL_PATTERNS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // A lane would be left pointing at freed keyframes. Stop it, or wait for it to finish, first.
+    if (buzzer_control_holds_pattern(pattern)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int slot = pattern - patterns;
+
+    portENTER_CRITICAL(&pool_lock);
+    if (!slot_used[slot]) {
+        portEXIT_CRITICAL(&pool_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for(int i=0; i<FRAME_BLOCK_COUNT; i++) {
+        if (block_owner[i] == slot + 1) {
+            block_owner[i] = BLOCK_FREE;
+            blocks_used--;
+        }
+    }
+    slot_used[slot] = false;
+    slots_used--;
+    portEXIT_CRITICAL(&pool_lock);
+
+    return ESP_OK;
+}
+
+void buzzer_pattern_pool_stats(size_t* patterns_used, size_t* frames_used) {
+    portENTER_CRITICAL(&pool_lock);
+    *patterns_used = slots_used;
+    *frames_used = blocks_used * FRAME_BLOCK_LEN;
+    portEXIT_CRITICAL(&pool_lock);
+}
@@ -0,0 +1,132 @@
+#include "buzzer_render.h"
+#include "buzzer_synth.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
+
+_Static_assert(BUZZER_RENDER_RATE_HZ == ISR_RATE_HZ, "renders must run at the synthesis ISR rate");
+
+static esp_err_t check_pattern(const buzzer_pattern_t *pattern, int passes)
+{
+    if (pattern == NULL || pattern->frame_count <= 0 || pattern->key_frames == NULL || pattern->waveform > BUZZER_WAV_SAW || passes <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+size_t buzzer_render_sample_count(const buzzer_pattern_t *pattern, int passes)
+{
+    if (check_pattern(pattern, passes) != ESP_OK)
+    {
+        return 0;
+    }
+
+    size_t ticks = 0;
+    for (int i = 0; i < pattern->frame_count; i++)
+    {
+        uint16_t duration = pattern->key_frames[i].duration;
+        ticks += duration > 0 ? duration * ISR_TICKS_PER_MS : 1;
+    }
+
+    return ticks * passes;
+}
+
+esp_err_t buzzer_render_pattern(const buzzer_pattern_t *pattern, int passes, int16_t *samples, size_t max_samples, size_t *count_out)
+{
+    ERROR_CHECK_RETURN(check_pattern(pattern, passes));
+    if (buzzer_render_sample_count(pattern, passes) > max_samples)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // The same tick and frame stepping as the ISR, with each pass through the pattern ending on the wrap.
+    buzzer_voice_t voice = {0};
+    int keyframe_idx = 0;
+    buzzer_voice_start_frame(&voice, &pattern->key_frames[0], pattern->waveform);
+
+    size_t count = 0;
+    int pass = 0;
+    while (pass < passes)
+    {
+        int8_t density;
+        bool frame_ended = buzzer_voice_tick(&voice, &density);
+        samples[count++] = density * 256;
+        if (!frame_ended)
+        {
+            continue;
+        }
+
+        const buzzer_keyframe_t *keyframe = buzzer_pattern_advance(pattern, &keyframe_idx);
+        if (keyframe_idx == 0)
+        {
+            pass++;
+            keyframe = &pattern->key_frames[0];
+        }
+        buzzer_voice_start_frame(&voice, keyframe, pattern->waveform);
+    }
+
+    *count_out = count;
+
+    return ESP_OK;
+}
+
+static void put_le(uint8_t *out, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out[i] = value >> (8 * i);
+    }
+}
+
+esp_err_t buzzer_render_wav(const buzzer_pattern_t *pattern, int passes, const char *path)
+{
+    ERROR_CHECK_RETURN(check_pattern(pattern, passes));
+
+    size_t max_samples = buzzer_render_sample_count(pattern, passes);
+    int16_t *samples = malloc(max_samples * sizeof(int16_t));
+    if (samples == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t count;
+    buzzer_render_pattern(pattern, passes, samples, max_samples, &count);
+
+    uint32_t data_len = count * sizeof(int16_t);
+    uint8_t header[44] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' '};
+    put_le(&header[4], 36 + data_len, 4);
+    put_le(&header[16], 16, 4);
+    put_le(&header[20], 1, 2);
+    put_le(&header[22], 1, 2);
+    put_le(&header[24], BUZZER_RENDER_RATE_HZ, 4);
+    put_le(&header[28], BUZZER_RENDER_RATE_HZ * sizeof(int16_t), 4);
+    put_le(&header[32], sizeof(int16_t), 2);
+    put_le(&header[34], 16, 2);
+    header[36] = 'd';
+    header[37] = 'a';
+    header[38] = 't';
+    header[39] = 'a';
+    put_le(&header[40], data_len, 4);
+
+    esp_err_t ret = ESP_FAIL;
+    FILE *out = fopen(path, "wb");
+    if (out != NULL)
+    {
+        // Samples are little endian on every host this builds for, like the replay traces.
+        if (fwrite(header, 1, sizeof(header), out) == sizeof(header) && fwrite(samples, sizeof(int16_t), count, out) == count)
+        {
+            ret = ESP_OK;
+        }
+        if (fclose(out) != 0)
+        {
+            ret = ESP_FAIL;
+        }
+    }
+
+    free(samples);
+
+    return ret;
+}
@@ -0,0 +1,157 @@
+#include "buzzer_sched.h"
+#include "buzzer_synth.h"
+#include "event_trace.h"
+
+static bool lane_push(buzzer_lane_t *lane, const buzzer_pattern_t *pattern)
+{
+    if (lane->count == BUZZER_SCHED_QUEUE_DEPTH)
+    {
+        return false;
+    }
+
+    if (lane->count == 0)
+    {
+        lane->keyframe_idx = 0;
+    }
+    lane->queue[(lane->head + lane->count) % BUZZER_SCHED_QUEUE_DEPTH] = pattern;
+    lane->count++;
+
+    return true;
+}
+
+static IRAM_ATTR void lane_pop(buzzer_lane_t *lane)
+{
+    lane->head = (lane->head + 1) % BUZZER_SCHED_QUEUE_DEPTH;
+    lane->count--;
+    lane->keyframe_idx = 0;
+}
+
+// Points pattern at the head of the highest non-empty lane. Returns false when that is already what is
+// sounding, unless the active lane's head was replaced.
+static IRAM_ATTR bool select_lane(buzzer_sched_t *sched, bool head_changed)
+{
+    int top = -1;
+    for (int i = BUZZER_PRIORITY_COUNT - 1; i >= 0; i--)
+    {
+        if (sched->lanes[i].count > 0)
+        {
+            top = i;
+            break;
+        }
+    }
+
+    if (top == sched->active_lane && !head_changed)
+    {
+        return false;
+    }
+
+    if (sched->active_lane >= 0 && sched->active_lane != top)
+    {
+        sched->lanes[sched->active_lane].keyframe_idx = sched->keyframe_idx;
+    }
+
+    sched->active_lane = top;
+    if (top < 0)
+    {
+        sched->pattern = NULL;
+        sched->keyframe_idx = 0;
+        return true;
+    }
+
+    buzzer_lane_t *lane = &sched->lanes[top];
+    sched->pattern = lane->queue[lane->head];
+    sched->keyframe_idx = lane->keyframe_idx;
+    event_trace_record(TRACE_BUZZER_RESET, sched->pattern->frame_count, sched->pattern->waveform);
+
+    return true;
+}
+
+esp_err_t buzzer_sched_check(const buzzer_pattern_t *pattern, buzzer_priority_t priority)
+{
+    if ((unsigned)priority >= BUZZER_PRIORITY_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (pattern != NULL && (pattern->frame_count <= 0 || pattern->key_frames == NULL || pattern->waveform > BUZZER_WAV_SAW))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+bool buzzer_sched_play(buzzer_sched_t *sched, const buzzer_pattern_t *pattern, buzzer_priority_t priority)
+{
+    buzzer_lane_t *lane = &sched->lanes[priority];
+    lane->count = 0;
+    if (pattern != NULL)
+    {
+        lane_push(lane, pattern);
+    }
+
+    return select_lane(sched, (int)priority == sched->active_lane);
+}
+
+esp_err_t buzzer_sched_queue(buzzer_sched_t *sched, const buzzer_pattern_t *pattern, buzzer_priority_t priority, bool *changed)
+{
+    if (!lane_push(&sched->lanes[priority], pattern))
+    {
+        *changed = false;
+        return ESP_ERR_NO_MEM;
+    }
+    *changed = select_lane(sched, false);
+
+    return ESP_OK;
+}
+
+bool buzzer_sched_clear(buzzer_sched_t *sched)
+{
+    for (int i = 0; i < BUZZER_PRIORITY_COUNT; i++)
+    {
+        sched->lanes[i].count = 0;
+    }
+
+    return select_lane(sched, false);
+}
+
+IRAM_ATTR const buzzer_keyframe_t *buzzer_sched_keyframe(const buzzer_sched_t *sched)
+{
+    return sched->pattern != NULL ? &sched->pattern->key_frames[sched->keyframe_idx] : NULL;
+}
+
+IRAM_ATTR const buzzer_keyframe_t *buzzer_sched_next(buzzer_sched_t *sched)
+{
+    if (sched->pattern == NULL)
+    {
+        return NULL;
+    }
+
+    const buzzer_keyframe_t *keyframe = buzzer_pattern_advance(sched->pattern, &sched->keyframe_idx);
+    if (keyframe != NULL)
+    {
+        return keyframe;
+    }
+
+    lane_pop(&sched->lanes[sched->active_lane]);
+    select_lane(sched, true);
+
+    return buzzer_sched_keyframe(sched);
+}
+
+bool buzzer_sched_holds(const buzzer_sched_t *sched, const buzzer_pattern_t *pattern)
+{
+    for (int i = 0; i < BUZZER_PRIORITY_COUNT; i++)
+    {
+        const buzzer_lane_t *lane = &sched->lanes[i];
+        for (int j = 0; j < lane->count; j++)
+        {
+            if (lane->queue[(lane->head + j) % BUZZER_SCHED_QUEUE_DEPTH] == pattern)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Lane scheduling shared by the output backends, the linux mock and the host tests, so preemption and resume
+// are the same code everywhere. Nothing here locks, callers hold their own lock around every call.
+
+#include "buzzer_control.h"
+#include "esp_attr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BUZZER_SCHED_QUEUE_DEPTH 4
+
+// One queue per priority. The lane that is sounding is the highest non-empty one, and a lane that gets
+// preempted keeps its keyframe index so it picks up where it was cut off.
+typedef struct
+{
+    const buzzer_pattern_t *queue[BUZZER_SCHED_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    int keyframe_idx;
+} buzzer_lane_t;
+
+typedef struct
+{
+    buzzer_lane_t lanes[BUZZER_PRIORITY_COUNT];
+    int active_lane;
+    // What is sounding, NULL when every lane is empty.
+    const buzzer_pattern_t *pattern;
+    int keyframe_idx;
+} buzzer_sched_t;
+
+#define BUZZER_SCHED_INITIALIZER { .active_lane = -1 }
+
+esp_err_t buzzer_sched_check(const buzzer_pattern_t *pattern, buzzer_priority_t priority);
+
+// Both return whether what is sounding changed, in which case the backend restarts its output at
+// buzzer_sched_keyframe(). Submissions are expected to have passed buzzer_sched_check().
+
+// Replaces everything queued at priority with pattern, or clears it when pattern is NULL.
+bool buzzer_sched_play(buzzer_sched_t *sched, const buzzer_pattern_t *pattern, buzzer_priority_t priority);
+
+// Returns ESP_ERR_NO_MEM when the lane is full.
+esp_err_t buzzer_sched_queue(buzzer_sched_t *sched, const buzzer_pattern_t *pattern, buzzer_priority_t priority, bool *changed);
+
+bool buzzer_sched_clear(buzzer_sched_t *sched);
+
+// The keyframe that should be sounding, NULL when nothing is.
+const buzzer_keyframe_t *buzzer_sched_keyframe(const buzzer_sched_t *sched);
+
+// Called when the sounding keyframe ends. Moves to the next one, falling back to the next queued or
+// interrupted pattern once a one-shot pattern has finished. Returns NULL when nothing is left to play.
+const buzzer_keyframe_t *buzzer_sched_next(buzzer_sched_t *sched);
+
+// Whether pattern is sounding, queued or parked in a preempted lane.
+bool buzzer_sched_holds(const buzzer_sched_t *sched, const buzzer_pattern_t *pattern);
+
+// Implemented by each backend over its scheduler, so buzzer_pattern_destroy() can refuse a pattern still in use.
+bool buzzer_control_holds_pattern(const buzzer_pattern_t *pattern);
@@ -0,0 +1,80 @@
+#pragma once
+
+// Per-sample synthesis and frame stepping shared by the GPTimer ISR and the host renderer, so a rendered
+// pattern is produced by the same code the buzzer plays.
+
+#include "buzzer_control.h"
+#include "buzzer_wavetables.h"
+#include "esp_attr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_ALARM_COUNT 20
+#define TIMER_RES 1000000
+#define ISR_RATE_HZ (TIMER_RES / TIMER_ALARM_COUNT)
+#define ISR_TICKS_PER_MS (ISR_RATE_HZ / 1000)
+
+#define WAVE_PHASE_SHIFT (32 - BUZZER_WAVE_TABLE_BITS)
+// 2^32 / ISR_RATE_HZ in Q8, so a note's phase step needs a multiply rather than a 64 bit divide.
+#define PHASE_INC_PER_HZ_Q8 ((uint32_t)((1ULL << 40) / ISR_RATE_HZ))
+#define SDM_IDLE_DENSITY -128
+
+typedef struct
+{
+    uint32_t phase_acc;
+    uint32_t phase_inc;
+    uint32_t frame_ticks_left;
+    const int8_t *waveform;
+} buzzer_voice_t;
+
+static const int8_t *const wave_tables[] = {
+    [BUZZER_WAV_SQUARE] = wave_square,
+    [BUZZER_WAV_SIN] = wave_sin,
+    [BUZZER_WAV_SAW] = wave_saw,
+};
+
+static inline IRAM_ATTR void buzzer_voice_start_frame(buzzer_voice_t *voice, const buzzer_keyframe_t *keyframe, buzzer_waveform_t waveform)
+{
+    // The phase carries on across notes so a change of pitch has neither a gap nor a click.
+    voice->frame_ticks_left = keyframe->duration > 0 ? keyframe->duration * ISR_TICKS_PER_MS : 1;
+    voice->phase_inc = (uint32_t)(((uint64_t)keyframe->frequency * PHASE_INC_PER_HZ_Q8) >> 8);
+    voice->waveform = keyframe->frequency > 0 ? wave_tables[waveform] : NULL;
+}
+
+// One ISR tick of output as sigma-delta pulse density.
+static inline IRAM_ATTR int8_t buzzer_voice_sample(buzzer_voice_t *voice)
+{
+    const int8_t *waveform = voice->waveform;
+    if (waveform == NULL)
+    {
+        return SDM_IDLE_DENSITY;
+    }
+
+    // The top byte of the wrapping phase indexes one period of the table.
+    voice->phase_acc += voice->phase_inc;
+    return waveform[voice->phase_acc >> WAVE_PHASE_SHIFT];
+}
+
+// One ISR tick: the sample for this tick, then the frame countdown. Returns true on the tick that ends the
+// frame, when the caller starts the next keyframe. The count is zero while idle, which never ends.
+static inline IRAM_ATTR bool buzzer_voice_tick(buzzer_voice_t *voice, int8_t *density_out)
+{
+    *density_out = buzzer_voice_sample(voice);
+    return voice->frame_ticks_left > 0 && --voice->frame_ticks_left == 0;
+}
+
+// Steps *keyframe_idx past a finished frame. Returns the next keyframe, or NULL once a one-shot pattern has
+// played its last, with the index back at 0 either way so a caller can count passes.
+static inline IRAM_ATTR const buzzer_keyframe_t *buzzer_pattern_advance(const buzzer_pattern_t *pattern, int *keyframe_idx)
+{
+    if (++*keyframe_idx == pattern->frame_count)
+    {
+        *keyframe_idx = 0;
+        if (!pattern->loop)
+        {
+            return NULL;
+        }
+    }
+
+    return &pattern->key_frames[*keyframe_idx];
+}
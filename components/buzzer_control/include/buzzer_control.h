@@ -19,9 +19,24 @@ typedef struct {
     bool loop;
     int frame_count;
     buzzer_waveform_t waveform;
-    buzzer_keyframe_t* key_frames;
+    const buzzer_keyframe_t* key_frames;
 } buzzer_pattern_t;
 
+// Higher priorities preempt lower ones. A preempted pattern resumes from the keyframe it was cut off at
+// once everything above it has finished.
+typedef enum {
+    BUZZER_PRIORITY_NOTIFY = 0,
+    BUZZER_PRIORITY_ALARM,
+    BUZZER_PRIORITY_COUNT,
+} buzzer_priority_t;
+
 esp_err_t buzzer_control_init();
 
-esp_err_t buzzer_control_play_pattern(buzzer_pattern_t* pattern);
\ No newline at end of file
+// Patterns are only read, so const tables from buzzer_patterns.mml can be played straight from flash.
+// Neither call blocks, so both are safe from any task.
+
+// Replaces everything queued at priority with pattern, or clears it when pattern is NULL.
+esp_err_t buzzer_control_play_pattern(const buzzer_pattern_t* pattern, buzzer_priority_t priority);
+
+// Plays pattern after those already queued at priority. Returns ESP_ERR_NO_MEM when that queue is full.
+esp_err_t buzzer_control_queue_pattern(const buzzer_pattern_t* pattern, buzzer_priority_t priority);
\ No newline at end of file
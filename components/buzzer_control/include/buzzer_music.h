@@ -1,7 +1,57 @@
 #pragma once
 
 #include "buzzer_control.h"
+#include "buzzer_pattern_pool.h"
+#include <stddef.h>
 
+// Music strings:
+//   a-g      note, optionally followed by # (sharp) or $ (flat), a length and dots
+//   r<n>     rest of n eighths of a whole note, dots allowed
+//   o<n>     octave 0-8, starts at 3
+//   l<n>     default note length in sixteenths of a whole note, starts at 1
+//   t<n>     tempo in quarter notes per minute, starts at 240 (a whole note per second)
+//   [...]<n> repeat the enclosed notes n times, 2 when n is left out. Nests 4 deep.
+// A dot adds half the length again, each further dot half of the last. Spaces are ignored.
+
+#define BUZZER_MUSIC_MAX_REPEAT_DEPTH 4
+
+// Parses in a single pass, writing keyframes into the caller's buffer as characters arrive,
+// so the string can be fed in chunks. The caller owns the struct, nothing is allocated.
+typedef struct {
+    buzzer_keyframe_t* frames;
+    size_t max_frames;
+    size_t frame_count;
+
+    esp_err_t err;
+    const char* err_msg;
+    size_t err_pos;
+
+    size_t pos;
+    size_t cmd_pos;
+    char cmd;
+    int8_t modifier;
+    uint8_t dots;
+    uint8_t digits;
+    uint32_t value;
+
+    uint16_t tempo;
+    uint8_t octave;
+    uint8_t note_len;
+    uint8_t repeat_depth;
+    size_t repeat_pos;
+    size_t repeat_start[BUZZER_MUSIC_MAX_REPEAT_DEPTH];
+} buzzer_music_parser_t;
+
+void buzzer_music_parser_init(buzzer_music_parser_t* parser, buzzer_keyframe_t* frames, size_t max_frames);
+
+// Returns ESP_ERR_INVALID_ARG on a syntax error and ESP_ERR_INVALID_SIZE when the buffer is full.
+// Once an error is returned the parser stays failed, with err_msg and err_pos describing it.
+esp_err_t buzzer_music_parser_feed(buzzer_music_parser_t* parser, const char* music, size_t len);
+
+// Completes the last command and checks the string as a whole. frame_count holds the result.
+esp_err_t buzzer_music_parser_finish(buzzer_music_parser_t* parser);
+
+// Both build into the runtime pattern pool, release the result with buzzer_pattern_destroy().
 esp_err_t parse_music_str(const char* music_str, buzzer_pattern_t** pattern_out);
 
 esp_err_t buzzer_frequency_sweep(uint16_t start_freq, uint16_t end_freq, uint16_t step_count, uint16_t duration_ms, buzzer_pattern_t** pattern_out);
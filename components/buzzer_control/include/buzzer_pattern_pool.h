@@ -0,0 +1,23 @@
+#pragma once
+
+#include "buzzer_control.h"
+#include <stddef.h>
+
+// Runtime patterns come from fixed static pools rather than the heap, so any number of create/destroy cycles
+// keeps memory flat. Sizes are set by CONFIG_BUZZER_PATTERN_POOL_PATTERNS and CONFIG_BUZZER_PATTERN_POOL_FRAMES.
+
+// Reserves a pattern with frame_count keyframes for the caller to fill in. Starts as a one-shot square wave.
+// Returns ESP_ERR_NO_MEM when either pool is exhausted.
+esp_err_t buzzer_pattern_create(int frame_count, buzzer_pattern_t** pattern_out, buzzer_keyframe_t** frames_out);
+
+// Like create, but takes the longest free run up to max_frames for when the length is not known yet.
+// frame_count is set to what was reserved. Hand back the unused tail with buzzer_pattern_shrink().
+esp_err_t buzzer_pattern_reserve(int max_frames, buzzer_pattern_t** pattern_out, buzzer_keyframe_t** frames_out);
+
+esp_err_t buzzer_pattern_shrink(buzzer_pattern_t* pattern, int frame_count);
+
+// Returns the pattern and its keyframes to the pools. Returns ESP_ERR_INVALID_STATE while the pattern is playing,
+// queued or waiting to resume in any buzzer_control lane.
+esp_err_t buzzer_pattern_destroy(buzzer_pattern_t* pattern);
+
+void buzzer_pattern_pool_stats(size_t* patterns_used, size_t* frames_used);
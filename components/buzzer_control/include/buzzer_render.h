@@ -0,0 +1,19 @@
+#pragma once
+
+#include "buzzer_control.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Linux target only. Runs a pattern through the same per-sample synthesis as the GPTimer ISR, one sample
+// per ISR tick, so timing and pitch can be checked or listened to without a board. Samples are the
+// sigma-delta pulse density scaled to 16 bits, silence sits at the idle density like the pin does.
+#define BUZZER_RENDER_RATE_HZ 50000
+
+// Samples produced by passes times through the pattern, whether or not it loops.
+size_t buzzer_render_sample_count(const buzzer_pattern_t* pattern, int passes);
+
+// Returns ESP_ERR_INVALID_SIZE when max_samples is below buzzer_render_sample_count().
+esp_err_t buzzer_render_pattern(const buzzer_pattern_t* pattern, int passes, int16_t* samples, size_t max_samples, size_t* count_out);
+
+// Writes a mono 16 bit WAV file.
+esp_err_t buzzer_render_wav(const buzzer_pattern_t* pattern, int passes, const char* path);
@@ -3,106 +3,266 @@
 #include "c3_led_blink.h"
 #include "led_strip.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
+#include "event_trace.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/queue.h"
-
-#define TASK_N_QUIT 1ULL<<0
-#define TASK_N_RESET 1ULL<<1
+#include "sdkconfig.h"
+#include <stdatomic.h>
+#include <string.h>
 
 #define LED_GPIO GPIO_NUM_8
 #define STRIP_RES_HZ 10000000
+#define ANIM_FRAME_US (1000000 / CONFIG_C3_LED_FRAME_RATE_HZ)
+
+// The requested output is one word, colour in the low 24 bits and mode above, so an update is a
+// single atomic store that the timer callback can never see half written.
+#define MODE_SHIFT 24
+#define MODE_OFF 0
+#define MODE_SOLID 1
+#define MODE_BLINK 2
+#define MODE_ANIM 3
+#define RGB_MASK 0xFFFFFF
+#define PACK_OUTPUT(mode, r, g, b) (((uint32_t)(mode) << MODE_SHIFT) | ((r) << 16) | ((g) << 8) | (b))
 
 #define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }} 
 
 static char* TAG = "C3_LED_BLINK";
 
 static led_strip_handle_t led_strip;
+static esp_timer_handle_t blink_timer;
+
+static atomic_uint_fast32_t requested_output;
+static atomic_uint_fast32_t blink_period_ms = 500;
 
-static uint32_t blink_period_ms = 500;
-static uint8_t blink_r;
-static uint8_t blink_g;
-static uint8_t blink_b;
+// An animation is too big for one atomic word, so it is handed over under a short lock and the
+// callback works on its own copy.
+static portMUX_TYPE anim_lock = portMUX_INITIALIZER_UNLOCKED;
+static led_anim_t requested_anim;
+static bool anim_pending;
+
+// Only touched by the esp_timer task, which is the one place the strip is driven from.
+static uint32_t shown_mode = MODE_OFF;
 static bool blink_on;
-static TaskHandle_t blink_task_handle;
-
-static void c3_blink_task(void *args)
-{
-    uint32_t notification = 0;
-
-    while (true)
-    {
-        if (xTaskNotifyWait(1, 1, &notification, (blink_period_ms / 2) / portTICK_PERIOD_MS))
-        {
-            if (notification & TASK_N_QUIT)
-            {
-                ESP_LOGI(TAG, "Quitting blink loop.");
-                led_strip_clear(led_strip);
-                break;
-            }
-        }
+static bool lit;
+static led_anim_t playing_anim;
+static uint8_t frame_rgb[CONFIG_C3_LED_COUNT * 3];
+static esp_err_t output_err = ESP_OK;
+
+// Held around the callback rearming the timer and around the stop and start in request_output(), so
+// neither can arm it in between the other's calls.
+static portMUX_TYPE timer_lock = portMUX_INITIALIZER_UNLOCKED;
 
-        ESP_LOGI(TAG, "Blink on: %d", blink_on);
-        if(blink_on) {
-            c3_set_color(blink_r, blink_g, blink_b);
-        } else {
-            led_strip_clear(led_strip);
+static esp_err_t show(uint32_t rgb) {
+    if(rgb == 0) {
+        ERROR_CHECK_RETURN(led_strip_clear(led_strip));
+    } else {
+        for(int i=0; i<CONFIG_C3_LED_COUNT; i++) {
+            ERROR_CHECK_RETURN(led_strip_set_pixel(led_strip, i, rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF));
         }
+        ERROR_CHECK_RETURN(led_strip_refresh(led_strip));
+    }
+    lit = rgb != 0;
+
+    return ESP_OK;
+}
+
+// Logs when the strip starts or stops failing rather than on every frame.
+static void note_output_result(esp_err_t ret) {
+    if(ret == output_err) {
+        return;
+    }
+
+    if(ret != ESP_OK) {
+        ESP_LOGW(TAG, "LED output failed: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "LED output recovered.");
+    }
+    output_err = ret;
+}
+
+// A request that came in while the callback ran has already armed the timer for its own output,
+// which then takes precedence over this frame's follow up.
+static void rearm(uint64_t timeout_us) {
+    portENTER_CRITICAL(&timer_lock);
+    esp_err_t ret = esp_timer_is_active(blink_timer) ? ESP_OK : esp_timer_start_once(blink_timer, timeout_us);
+    portEXIT_CRITICAL(&timer_lock);
+
+    if(ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to rearm the LED timer: %s", esp_err_to_name(ret));
+    }
+}
+
+static esp_err_t show_anim_frame() {
+    portENTER_CRITICAL(&anim_lock);
+    if(anim_pending) {
+        playing_anim = requested_anim;
+        anim_pending = false;
+    }
+    portEXIT_CRITICAL(&anim_lock);
+
+    // Steady output needs no more frames until the next animation kicks the timer.
+    if(led_anim_render(&playing_anim, esp_timer_get_time() / 1000, frame_rgb)) {
+        rearm(ANIM_FRAME_US);
+    }
+
+    for(int i=0; i<CONFIG_C3_LED_COUNT; i++) {
+        ERROR_CHECK_RETURN(led_strip_set_pixel(led_strip, i, frame_rgb[i * 3], frame_rgb[i * 3 + 1], frame_rgb[i * 3 + 2]));
+    }
+    ERROR_CHECK_RETURN(led_strip_refresh(led_strip));
+    lit = true;
 
-        blink_on = !blink_on;
+    return ESP_OK;
+}
+
+static void blink_timer_cb(void* args) {
+    uint32_t output = atomic_load_explicit(&requested_output, memory_order_relaxed);
+    uint32_t rgb = output & RGB_MASK;
+    uint32_t mode = output >> MODE_SHIFT;
+
+    // A blink starts on its lit half.
+    if(mode != shown_mode) {
+        shown_mode = mode;
+        blink_on = true;
     }
 
-    vTaskDelete(NULL);
+    esp_err_t ret = ESP_OK;
+    switch(mode) {
+        case MODE_BLINK:
+            event_trace_record(TRACE_BLINK_TOGGLE, blink_on, rgb);
+            rearm(atomic_load_explicit(&blink_period_ms, memory_order_relaxed) * 1000 / 2);
+            ret = show(blink_on ? rgb : 0);
+            blink_on = !blink_on;
+            break;
+        case MODE_SOLID:
+            ret = show(rgb);
+            break;
+        case MODE_ANIM:
+            ret = show_anim_frame();
+            break;
+        default:
+            if(lit) {
+                ESP_LOGI(TAG, "Blink stopped.");
+                ret = show(0);
+            }
+            break;
+    }
+    note_output_result(ret);
+}
+
+// Publishes a new output. A running blink picks up a new colour or period at the next toggle and
+// keeps its phase, anything else fires the timer straight away. Fails with ESP_ERR_INVALID_STATE
+// before c3_led_blink_init().
+static esp_err_t request_output(uint32_t output) {
+    if(blink_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t previous = atomic_exchange_explicit(&requested_output, output, memory_order_relaxed);
+    if(previous >> MODE_SHIFT == MODE_BLINK && output >> MODE_SHIFT == MODE_BLINK) {
+        return ESP_OK;
+    }
+
+    // Stopping an idle timer fails harmlessly, the start can then only fail for a real reason.
+    portENTER_CRITICAL(&timer_lock);
+    esp_timer_stop(blink_timer);
+    esp_err_t ret = esp_timer_start_once(blink_timer, 0);
+    portEXIT_CRITICAL(&timer_lock);
+
+    return ret;
 }
 
 esp_err_t c3_led_blink_init() {
     led_strip_config_t strip_config = {
         .strip_gpio_num = LED_GPIO,
-        .max_leds = 1
+        .max_leds = CONFIG_C3_LED_COUNT
     };
+    // Async refresh queues the frame and returns, so setting a colour does not wait out the transmission.
+    // The symbol table costs 8 KB, which only pays off on a strip.
     led_strip_rmt_config_t rmt_config = {
-        .resolution_hz = STRIP_RES_HZ
+        .resolution_hz = STRIP_RES_HZ,
+        .flags.async_refresh = true,
+        .flags.symbol_table = CONFIG_C3_LED_COUNT > 1
     };
     
     ERROR_CHECK_RETURN(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
     ERROR_CHECK_RETURN(led_strip_clear(led_strip));
-    
-    return ESP_OK;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = blink_timer_cb,
+        .name = "c3_blink",
+    };
+
+    return esp_timer_create(&timer_args, &blink_timer);
 }
 
 esp_err_t c3_set_color(uint8_t r, uint8_t g, uint8_t b) {
-    ERROR_CHECK_RETURN(led_strip_set_pixel(led_strip, 0, r, g, b));
-    ERROR_CHECK_RETURN(led_strip_refresh(led_strip));
-
-    return ESP_OK;
+    return request_output(PACK_OUTPUT(MODE_SOLID, r, g, b));
 }
 
 esp_err_t c3_blink_color(uint8_t r, uint8_t g, uint8_t b, uint32_t period_ms) {
     if(period_ms < 20 || period_ms > 10000) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    blink_r = r;
-    blink_g = g;
-    blink_b = b;
-    blink_period_ms = period_ms;
 
-    if(blink_task_handle == NULL) {
-        blink_on = true;
-        xTaskCreate(c3_blink_task, "Buzzer Task", 2048, NULL, 5, &blink_task_handle);
-    }
-
-    return ESP_OK;
+    atomic_store_explicit(&blink_period_ms, period_ms, memory_order_relaxed);
+    return request_output(PACK_OUTPUT(MODE_BLINK, r, g, b));
 }
 
 esp_err_t c3_stop_blink() {
-    if(blink_task_handle == NULL) {
+    if(atomic_load_explicit(&requested_output, memory_order_relaxed) >> MODE_SHIFT != MODE_BLINK) {
         return ESP_FAIL;
     }
 
-    xTaskNotify(blink_task_handle, 1, eSetBits);
-    blink_task_handle = NULL;
+    return request_output(PACK_OUTPUT(MODE_OFF, 0, 0, 0));
+}
 
-    return ESP_OK;
+esp_err_t c3_play_animation(const led_anim_t* anim) {
+    if(anim->led_count != CONFIG_C3_LED_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&anim_lock);
+    requested_anim = *anim;
+    requested_anim.start_ms = esp_timer_get_time() / 1000;
+    anim_pending = true;
+    portEXIT_CRITICAL(&anim_lock);
+
+    return request_output(PACK_OUTPUT(MODE_ANIM, 0, 0, 0));
 }
 
+esp_err_t c3_show_levels(const int8_t* levels, uint8_t count) {
+    static int8_t shown_levels[LED_ANIM_MAX_SEGMENTS];
+    static uint8_t shown_count;
+
+    uint8_t segment_count = count;
+    if(segment_count > LED_ANIM_MAX_SEGMENTS) {
+        segment_count = LED_ANIM_MAX_SEGMENTS;
+    }
+    if(segment_count > CONFIG_C3_LED_COUNT) {
+        segment_count = CONFIG_C3_LED_COUNT;
+    }
+    if(segment_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(segment_count == shown_count && memcmp(levels, shown_levels, segment_count) == 0
+            && atomic_load_explicit(&requested_output, memory_order_relaxed) >> MODE_SHIFT == MODE_ANIM) {
+        return ESP_OK;
+    }
+    memcpy(shown_levels, levels, segment_count);
+    shown_count = segment_count;
+
+    led_anim_t anim;
+    led_anim_init(&anim, CONFIG_C3_LED_COUNT, CONFIG_C3_LED_BRIGHTNESS);
+    uint32_t packed_levels = 0;
+    for(int i=0; i<segment_count; i++) {
+        led_anim_segment_t segment = led_anim_level_segment(levels[i]);
+        segment.first_led = i * CONFIG_C3_LED_COUNT / segment_count;
+        segment.led_count = (i + 1) * CONFIG_C3_LED_COUNT / segment_count - segment.first_led;
+        ERROR_CHECK_RETURN(led_anim_add_segment(&anim, &segment));
+        packed_levels |= (uint32_t)(levels[i] & 0xF) << (i * 4);
+    }
+    event_trace_record(TRACE_LED_LEVELS, segment_count, packed_levels);
+
+    return c3_play_animation(&anim);
+}
@@ -0,0 +1,74 @@
+#include "c3_led_blink.h"
+#include <stdbool.h>
+#include "event_trace.h"
+#include "sdkconfig.h"
+
+// Linux target backend with no LED strip. Colour changes are traced instead of shown, and a
+// blink is recorded once when it starts rather than on every toggle.
+
+static bool blinking;
+
+esp_err_t c3_led_blink_init() {
+    return ESP_OK;
+}
+
+esp_err_t c3_set_color(uint8_t r, uint8_t g, uint8_t b) {
+    event_trace_record(TRACE_BLINK_TOGGLE, 1, (r << 16) | (g << 8) | b);
+
+    return ESP_OK;
+}
+
+esp_err_t c3_blink_color(uint8_t r, uint8_t g, uint8_t b, uint32_t period_ms) {
+    if(period_ms < 20 || period_ms > 10000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(!blinking) {
+        blinking = true;
+        c3_set_color(r, g, b);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t c3_stop_blink() {
+    if(!blinking) {
+        return ESP_FAIL;
+    }
+
+    blinking = false;
+    event_trace_record(TRACE_BLINK_TOGGLE, 0, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t c3_play_animation(const led_anim_t* anim) {
+    return anim->led_count == CONFIG_C3_LED_COUNT ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t c3_show_levels(const int8_t* levels, uint8_t count) {
+    static uint32_t shown_levels;
+    static uint8_t shown_count;
+
+    if(count > LED_ANIM_MAX_SEGMENTS) {
+        count = LED_ANIM_MAX_SEGMENTS;
+    }
+    if(count > CONFIG_C3_LED_COUNT) {
+        count = CONFIG_C3_LED_COUNT;
+    }
+    if(count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t packed_levels = 0;
+    for(int i=0; i<count; i++) {
+        packed_levels |= (uint32_t)(levels[i] & 0xF) << (i * 4);
+    }
+    if(count != shown_count || packed_levels != shown_levels) {
+        shown_count = count;
+        shown_levels = packed_levels;
+        event_trace_record(TRACE_LED_LEVELS, count, packed_levels);
+    }
+
+    return ESP_OK;
+}
@@ -1,11 +1,23 @@
 #pragma once
 
 #include "esp_err.h"
+#include "led_anim.h"
 
 esp_err_t c3_led_blink_init();
 
+// The output calls return ESP_ERR_INVALID_STATE until c3_led_blink_init() has succeeded.
 esp_err_t c3_set_color(uint8_t r, uint8_t g, uint8_t b);
 
 esp_err_t c3_blink_color(uint8_t r, uint8_t g, uint8_t b, uint32_t period_ms);
 
 esp_err_t c3_stop_blink();
+
+// Plays an animation over the CONFIG_C3_LED_COUNT LEDs, starting now. The animation is copied, its
+// keyframes are not and must stay valid while it plays.
+esp_err_t c3_play_animation(const led_anim_t* anim);
+
+// Gives each probe an equal segment of the strip showing its hydro_level_t as a bar coloured by severity,
+// pulsing when high or when the probe has failed. Only restarts the animation when a level has changed,
+// so it can be called on every poll. Probes past LED_ANIM_MAX_SEGMENTS or the LED count are not shown.
+// Call from one task.
+esp_err_t c3_show_levels(const int8_t* levels, uint8_t count);
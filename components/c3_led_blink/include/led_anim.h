@@ -0,0 +1,53 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed point LED animations for a strip split into segments. Each segment takes its colour from a
+// steady rgb, keyframed fades or a pulse, and lights a fraction of its LEDs as a level bar. The colour
+// is worked out once per segment per frame, so a fully lit LED costs three byte copies and only the
+// partly lit LED at the end of a bar needs its own multiply. Output is gamma corrected.
+
+#define LED_ANIM_MAX_SEGMENTS 8
+#define LED_ANIM_FILL_FULL 255
+
+typedef struct {
+    uint32_t rgb;           // 0xRRGGBB
+    uint16_t duration_ms;   // time to fade to the next keyframe, or hold for the last one
+} led_anim_keyframe_t;
+
+typedef struct {
+    uint8_t first_led;
+    uint8_t led_count;
+    uint8_t fill;                           // lit part of the segment in 1/255, LED_ANIM_FILL_FULL for all of it
+    uint16_t pulse_ms;                      // breathes from full to off and back over this period, 0 for steady
+    uint32_t rgb;                           // used when there are no keyframes
+    const led_anim_keyframe_t* keyframes;   // must outlive the animation
+    uint8_t keyframe_count;
+    bool loop;                              // wraps the keyframes rather than holding the last one
+} led_anim_segment_t;
+
+typedef struct {
+    led_anim_segment_t segments[LED_ANIM_MAX_SEGMENTS];
+    uint8_t segment_count;
+    uint8_t led_count;
+    uint8_t brightness;
+    uint32_t start_ms;
+} led_anim_t;
+
+// Starts with no segments, so every LED is off.
+void led_anim_init(led_anim_t* anim, uint8_t led_count, uint8_t brightness);
+
+// Returns ESP_ERR_INVALID_SIZE when the segments are full and ESP_ERR_INVALID_ARG when the segment runs
+// past the strip or its keyframes are missing.
+esp_err_t led_anim_add_segment(led_anim_t* anim, const led_anim_segment_t* segment);
+
+// Writes led_count RGB triplets for the time now_ms. LEDs outside every segment are off and later
+// segments draw over earlier ones. Returns false once the output can no longer change, when the
+// caller may stop rendering frames.
+bool led_anim_render(const led_anim_t* anim, uint32_t now_ms, uint8_t* rgb_out);
+
+// Segment style for a hydro_level_t, with -1 for a failed probe: a bar that grows and warms in colour
+// with severity, pulsing at the highest level and on failure. first_led and led_count are left at zero.
+led_anim_segment_t led_anim_level_segment(int8_t level);
@@ -0,0 +1,136 @@
+#include "led_anim.h"
+#include "led_gamma.h"
+#include <string.h>
+
+// Intensity is Q8, 256 being full, and is combined with brightness into one Q16 scale per segment.
+#define INTENSITY_FULL 256
+
+#define LEVEL_FAILED -1
+#define LEVEL_HIGHEST 3
+
+// Indexed by level + 1, so a failed probe comes first.
+static const led_anim_segment_t level_segments[] = {
+    { .fill = LED_ANIM_FILL_FULL, .rgb = 0x0000FF, .pulse_ms = 2000 },
+    { .fill = 64, .rgb = 0x00FF00 },
+    { .fill = 128, .rgb = 0xFFC000 },
+    { .fill = 192, .rgb = 0xFF4000 },
+    { .fill = LED_ANIM_FILL_FULL, .rgb = 0xFF0000, .pulse_ms = 600 },
+};
+
+static uint32_t lerp_rgb(uint32_t from, uint32_t to, uint32_t t_q8) {
+    uint32_t out = 0;
+    for(int shift = 0; shift <= 16; shift += 8) {
+        int32_t a = (from >> shift) & 0xFF;
+        int32_t b = (to >> shift) & 0xFF;
+        out |= (uint32_t)(a + (((b - a) * (int32_t)t_q8) >> 8)) << shift;
+    }
+
+    return out;
+}
+
+// Colour of the keyframe track at elapsed_ms. Clears animating once a track that does not loop has ended.
+static uint32_t keyframe_rgb(const led_anim_segment_t* segment, uint32_t elapsed_ms, bool* animating) {
+    const led_anim_keyframe_t* keyframes = segment->keyframes;
+    uint8_t count = segment->keyframe_count;
+
+    uint32_t total_ms = 0;
+    for(int i=0; i<count; i++) {
+        total_ms += keyframes[i].duration_ms;
+    }
+    if (segment->loop && total_ms > 0) {
+        elapsed_ms %= total_ms;
+    }
+
+    for(int i=0; i<count; i++) {
+        uint16_t duration = keyframes[i].duration_ms;
+        if (elapsed_ms < duration) {
+            int next = i + 1 < count ? i + 1 : (segment->loop ? 0 : i);
+            *animating = true;
+            return lerp_rgb(keyframes[i].rgb, keyframes[next].rgb, (elapsed_ms << 8) / duration);
+        }
+        elapsed_ms -= duration;
+    }
+
+    return keyframes[segment->loop ? 0 : count - 1].rgb;
+}
+
+// A triangle from full down to off and back, which the gamma table turns into an even looking breath.
+static uint32_t pulse_intensity(uint16_t pulse_ms, uint32_t elapsed_ms) {
+    uint32_t phase = (elapsed_ms % pulse_ms) * (2 * INTENSITY_FULL) / pulse_ms;
+    return phase < INTENSITY_FULL ? INTENSITY_FULL - phase : phase - INTENSITY_FULL;
+}
+
+static void scale_rgb(uint32_t rgb, uint32_t scale_q16, uint8_t* out) {
+    out[0] = led_gamma[((rgb >> 16) & 0xFF) * scale_q16 >> 16];
+    out[1] = led_gamma[((rgb >> 8) & 0xFF) * scale_q16 >> 16];
+    out[2] = led_gamma[(rgb & 0xFF) * scale_q16 >> 16];
+}
+
+void led_anim_init(led_anim_t* anim, uint8_t led_count, uint8_t brightness) {
+    memset(anim, 0, sizeof(*anim));
+    anim->led_count = led_count;
+    anim->brightness = brightness;
+}
+
+esp_err_t led_anim_add_segment(led_anim_t* anim, const led_anim_segment_t* segment) {
+    if (segment->led_count == 0 || segment->first_led + segment->led_count > anim->led_count
+            || (segment->keyframe_count > 0 && segment->keyframes == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (anim->segment_count == LED_ANIM_MAX_SEGMENTS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    anim->segments[anim->segment_count++] = *segment;
+
+    return ESP_OK;
+}
+
+led_anim_segment_t led_anim_level_segment(int8_t level) {
+    if (level < LEVEL_FAILED) {
+        level = LEVEL_FAILED;
+    } else if (level > LEVEL_HIGHEST) {
+        level = LEVEL_HIGHEST;
+    }
+
+    return level_segments[level + 1];
+}
+
+bool led_anim_render(const led_anim_t* anim, uint32_t now_ms, uint8_t* rgb_out) {
+    uint32_t elapsed_ms = now_ms - anim->start_ms;
+    bool animating = false;
+
+    memset(rgb_out, 0, anim->led_count * 3);
+    for(int s=0; s<anim->segment_count; s++) {
+        const led_anim_segment_t* segment = &anim->segments[s];
+
+        uint32_t rgb = segment->keyframe_count > 0 ? keyframe_rgb(segment, elapsed_ms, &animating) : segment->rgb;
+        uint32_t intensity = INTENSITY_FULL;
+        if (segment->pulse_ms > 0) {
+            intensity = pulse_intensity(segment->pulse_ms, elapsed_ms);
+            animating = true;
+        }
+        uint32_t scale_q16 = intensity * (anim->brightness + 1);
+
+        // The bar's length in Q8 LEDs: whole LEDs share one colour, the one after them takes the remainder.
+        uint32_t lit_q8 = (uint32_t)segment->fill * segment->led_count * 256 / LED_ANIM_FILL_FULL;
+        uint32_t full_leds = lit_q8 >> 8;
+        uint8_t* out = &rgb_out[segment->first_led * 3];
+
+        uint8_t lit[3];
+        scale_rgb(rgb, scale_q16, lit);
+        for(uint32_t i=0; i<full_leds; i++) {
+            out[i * 3] = lit[0];
+            out[i * 3 + 1] = lit[1];
+            out[i * 3 + 2] = lit[2];
+        }
+        for(uint32_t i=full_leds; i<segment->led_count; i++) {
+            out[i * 3] = out[i * 3 + 1] = out[i * 3 + 2] = 0;
+        }
+        if (full_leds < segment->led_count) {
+            scale_rgb(rgb, scale_q16 * (lit_q8 & 0xFF) >> 8, &out[full_leds * 3]);
+        }
+    }
+
+    return animating;
+}
@@ -0,0 +1,156 @@
+#include "event_bus.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdatomic.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#else
+#include "esp_timer.h"
+#endif
+
+#define QUEUE_DEPTH CONFIG_EVENT_BUS_QUEUE_DEPTH
+#define QUEUE_MASK (QUEUE_DEPTH - 1)
+
+_Static_assert((QUEUE_DEPTH & QUEUE_MASK) == 0, "event bus queue depth must be a power of two");
+// With one slot, an unread event marked pos + 1 would read as free to the producer claiming pos + 1.
+_Static_assert(QUEUE_DEPTH >= 2, "event bus queue depth must be at least 2");
+_Static_assert(EVENT_BUS_TYPE_COUNT <= 32, "event types must fit the subscription mask");
+
+// Each slot's seq says whose turn it is: pos when free for the producer claiming position pos, pos + 1
+// once that event is written, and pos + QUEUE_DEPTH after the consumer has read it and handed it back.
+typedef struct {
+    _Atomic uint32_t seq;
+    event_bus_event_t event;
+} event_slot_t;
+
+struct event_bus_subscriber {
+    uint32_t type_mask;
+    _Atomic(TaskHandle_t) task;
+    _Atomic uint32_t head;
+    uint32_t tail;
+    atomic_uint_fast32_t dropped;
+    event_slot_t slots[QUEUE_DEPTH];
+};
+
+static event_bus_subscriber_t subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+static atomic_uint_fast32_t subscriber_count;
+static atomic_bool subscriber_ready[EVENT_BUS_MAX_SUBSCRIBERS];
+
+uint32_t event_bus_now_us() {
+#if CONFIG_IDF_TARGET_LINUX
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+#else
+    return (uint32_t)esp_timer_get_time();
+#endif
+}
+
+esp_err_t event_bus_subscribe(uint32_t type_mask, event_bus_subscriber_t** subscriber_out) {
+    if(type_mask == 0 || subscriber_out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t index = atomic_fetch_add_explicit(&subscriber_count, 1, memory_order_relaxed);
+    if(index >= EVENT_BUS_MAX_SUBSCRIBERS) {
+        atomic_fetch_sub_explicit(&subscriber_count, 1, memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+
+    event_bus_subscriber_t* subscriber = &subscribers[index];
+    subscriber->type_mask = type_mask;
+    for(uint32_t i=0; i<QUEUE_DEPTH; i++) {
+        atomic_init(&subscriber->slots[i].seq, i);
+    }
+    atomic_store_explicit(&subscriber_ready[index], true, memory_order_release);
+
+    *subscriber_out = subscriber;
+    return ESP_OK;
+}
+
+static bool push(event_bus_subscriber_t* subscriber, const event_bus_event_t* event) {
+    uint32_t pos = atomic_load_explicit(&subscriber->head, memory_order_relaxed);
+    event_slot_t* slot;
+    while(true) {
+        slot = &subscriber->slots[pos & QUEUE_MASK];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int32_t lag = (int32_t)(seq - pos);
+        if(lag == 0) {
+            // Free for this position, claim it against other producers.
+            if(atomic_compare_exchange_weak_explicit(&subscriber->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if(lag < 0) {
+            // Still holds the event from a lap ago, the consumer is behind.
+            return false;
+        } else {
+            pos = atomic_load_explicit(&subscriber->head, memory_order_relaxed);
+        }
+    }
+
+    slot->event = *event;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+esp_err_t event_bus_publish(event_bus_event_t* event) {
+    if(event == NULL || event->type >= EVENT_BUS_TYPE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event->timestamp_us = event_bus_now_us();
+
+    esp_err_t ret = ESP_OK;
+    uint32_t count = atomic_load_explicit(&subscriber_count, memory_order_relaxed);
+    for(uint32_t i=0; i<count && i<EVENT_BUS_MAX_SUBSCRIBERS; i++) {
+        event_bus_subscriber_t* subscriber = &subscribers[i];
+        if(!atomic_load_explicit(&subscriber_ready[i], memory_order_acquire) || !(subscriber->type_mask & EVENT_BUS_MASK(event->type))) {
+            continue;
+        }
+
+        if(!push(subscriber, event)) {
+            atomic_fetch_add_explicit(&subscriber->dropped, 1, memory_order_relaxed);
+            ret = ESP_ERR_NO_MEM;
+            continue;
+        }
+
+        TaskHandle_t task = atomic_load_explicit(&subscriber->task, memory_order_acquire);
+        if(task != NULL) {
+            xTaskNotifyGive(task);
+        }
+    }
+
+    return ret;
+}
+
+bool event_bus_receive(event_bus_subscriber_t* subscriber, event_bus_event_t* event_out) {
+    event_slot_t* slot = &subscriber->slots[subscriber->tail & QUEUE_MASK];
+    if(atomic_load_explicit(&slot->seq, memory_order_acquire) != subscriber->tail + 1) {
+        return false;
+    }
+
+    *event_out = slot->event;
+    atomic_store_explicit(&slot->seq, subscriber->tail + QUEUE_DEPTH, memory_order_release);
+    subscriber->tail++;
+    return true;
+}
+
+bool event_bus_wait(event_bus_subscriber_t* subscriber, event_bus_event_t* event_out, TickType_t timeout) {
+    // The ring is checked after the task is known, and notifications count up, so an event published
+    // at any point either is found here or leaves a notification behind.
+    atomic_store_explicit(&subscriber->task, xTaskGetCurrentTaskHandle(), memory_order_release);
+
+    while(!event_bus_receive(subscriber, event_out)) {
+        if(ulTaskNotifyTake(pdTRUE, timeout) == 0) {
+            return event_bus_receive(subscriber, event_out);
+        }
+    }
+
+    return true;
+}
+
+uint32_t event_bus_dropped(const event_bus_subscriber_t* subscriber) {
+    return atomic_load_explicit(&subscriber->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Typed publish/subscribe between the sensor loop and the actuators. Every subscriber owns a bounded
+// multi-producer, single-consumer ring, so a slow consumer only loses its own events and never holds
+// up the publisher or the other subscribers. Publishing copies the event into each matching ring and
+// wakes the subscriber's task with a notification. Neither side waits on the other, but targets without
+// atomic instructions, like the ESP32-C3, mask interrupts around each compare-and-swap and counter update,
+// so a publish is a few very short critical sections rather than lock free.
+// Depth is set by CONFIG_EVENT_BUS_QUEUE_DEPTH.
+
+#define EVENT_BUS_MAX_SUBSCRIBERS 4
+#define EVENT_BUS_MAX_PROBES 8
+
+typedef enum {
+    EVENT_BUS_LEVEL,    // a sensor level was acted on, sent on a change and then once per poll period
+    EVENT_BUS_TYPE_COUNT,
+} event_bus_type_t;
+
+#define EVENT_BUS_MASK(type) (1UL << (type))
+
+typedef struct {
+    int8_t level;                               // hydro_level_t the alarm follows
+    bool changed;                               // differs from the level sent before
+    uint8_t probe_count;                        // probes with their own level, 0 when only one is read
+    int8_t probe_levels[EVENT_BUS_MAX_PROBES];
+} event_bus_level_t;
+
+typedef struct {
+    uint32_t timestamp_us;  // stamped on publish by event_bus_now_us()
+    uint8_t type;
+    union {
+        event_bus_level_t level;
+    };
+} event_bus_event_t;
+
+typedef struct event_bus_subscriber event_bus_subscriber_t;
+
+// Subscribers are meant to be set up once at start and live for good. type_mask is made of EVENT_BUS_MASK()s.
+// Returns ESP_ERR_NO_MEM once EVENT_BUS_MAX_SUBSCRIBERS exist.
+esp_err_t event_bus_subscribe(uint32_t type_mask, event_bus_subscriber_t** subscriber_out);
+
+// Safe from any task. Returns ESP_ERR_NO_MEM when a subscriber's ring was full, that subscriber drops
+// the event and counts it while the others still get it.
+esp_err_t event_bus_publish(event_bus_event_t* event);
+
+// Takes the oldest event without blocking. Only one task may consume a subscriber.
+bool event_bus_receive(event_bus_subscriber_t* subscriber, event_bus_event_t* event_out);
+
+// Blocks until an event arrives or the timeout passes. The task that waits is the one woken on publish.
+bool event_bus_wait(event_bus_subscriber_t* subscriber, event_bus_event_t* event_out, TickType_t timeout);
+
+uint32_t event_bus_dropped(const event_bus_subscriber_t* subscriber);
+
+// Microseconds on the clock events are stamped with, for measuring delivery latency.
+uint32_t event_bus_now_us();
@@ -0,0 +1,116 @@
+#include "event_trace.h"
+#include <stdio.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#else
+#include "esp_timer.h"
+#endif
+
+#define TRACE_RECORD_COUNT CONFIG_EVENT_TRACE_RECORDS
+#define TRACE_RECORD_MASK (TRACE_RECORD_COUNT - 1)
+
+_Static_assert((TRACE_RECORD_COUNT & TRACE_RECORD_MASK) == 0, "trace record count must be a power of two");
+
+// Each slot is a seqlock, seq is 0 while a writer is filling it and seq + 1 of its record once complete.
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t timestamp_us;
+    uint16_t id;
+    uint16_t arg16;
+    uint32_t arg32;
+} trace_slot_t;
+
+static trace_slot_t trace_ring[TRACE_RECORD_COUNT];
+static atomic_uint_fast32_t trace_head;
+
+#if CONFIG_IDF_TARGET_LINUX
+static event_trace_clock_t trace_clock;
+#endif
+
+static inline uint32_t trace_timestamp_us() {
+#if CONFIG_IDF_TARGET_LINUX
+    if(trace_clock != NULL) {
+        return trace_clock();
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+#else
+    return (uint32_t)esp_timer_get_time();
+#endif
+}
+
+void IRAM_ATTR event_trace_record(event_trace_id_t id, uint16_t arg16, uint32_t arg32) {
+    uint32_t seq = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    trace_slot_t *slot = &trace_ring[seq & TRACE_RECORD_MASK];
+
+    // The slot may still hold a record from the previous lap, so it is marked invalid before the payload
+    // changes and only gets its new seq once the payload is complete.
+    atomic_store_explicit(&slot->seq, 0, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+    slot->timestamp_us = trace_timestamp_us();
+    slot->id = id;
+    slot->arg16 = arg16;
+    slot->arg32 = arg32;
+    atomic_store_explicit(&slot->seq, (uint32_t)(seq + 1), memory_order_release);
+}
+
+size_t event_trace_snapshot(event_trace_record_t *records, size_t max_count) {
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_acquire);
+    uint32_t available = head < TRACE_RECORD_COUNT ? head : TRACE_RECORD_COUNT;
+    if(available > max_count) {
+        available = max_count;
+    }
+
+    size_t count = 0;
+    for(uint32_t seq = head - available; seq != head; seq++) {
+        const trace_slot_t *slot = &trace_ring[seq & TRACE_RECORD_MASK];
+
+        uint32_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        event_trace_record_t record = {
+            .seq = seq + 1,
+            .timestamp_us = slot->timestamp_us,
+            .id = slot->id,
+            .arg16 = slot->arg16,
+            .arg32 = slot->arg32,
+        };
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+        // A record still being written, or rewritten by a newer writer while it was copied, is dropped.
+        if(before != seq + 1 || after != seq + 1) {
+            continue;
+        }
+
+        records[count++] = record;
+    }
+
+    return count;
+}
+
+void event_trace_dump() {
+    static event_trace_record_t dump_records[TRACE_RECORD_COUNT];
+    size_t count = event_trace_snapshot(dump_records, TRACE_RECORD_COUNT);
+
+    for(size_t i = 0; i < count; i++) {
+        const event_trace_record_t *record = &dump_records[i];
+        printf("ET:%08lx%08lx%04x%04x%08lx\n", (unsigned long)record->seq, (unsigned long)record->timestamp_us,
+               record->id, record->arg16, (unsigned long)record->arg32);
+    }
+}
+
+esp_err_t event_trace_set_clock(event_trace_clock_t clock) {
+#if CONFIG_IDF_TARGET_LINUX
+    trace_clock = clock;
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Each event has one 16 bit and one 32 bit argument, formatted in that order by the host decoder.
+// tools/event_trace_decode.py parses this table, so keep one X() per line.
+#define EVENT_TRACE_EVENTS(X) \
+    X(TRACE_HYDRO_READ, "hydro read raw=%u mv=%u") \
+    X(TRACE_HYDRO_LEVEL, "hydro probe=%u level=%d") \
+    X(TRACE_HYDRO_CROSSING, "hydro crossing=%u mv=%u") \
+    X(TRACE_HYDRO_TREND, "hydro trend warning=%u rate=%d") \
+    X(TRACE_BUZZER_RESET, "buzzer reset frames=%u waveform=%u") \
+    X(TRACE_BUZZER_FRAME, "buzzer frame=%u freq=%u") \
+    X(TRACE_BLINK_TOGGLE, "blink on=%u rgb=%06x") \
+    X(TRACE_LED_LEVELS, "led segments=%u levels=%08x") \
+
+typedef enum {
+#define EVENT_TRACE_ENUM(id, fmt) id,
+    EVENT_TRACE_EVENTS(EVENT_TRACE_ENUM)
+#undef EVENT_TRACE_ENUM
+    TRACE_EVENT_COUNT,
+} event_trace_id_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t timestamp_us;
+    uint16_t id;
+    uint16_t arg16;
+    uint32_t arg32;
+} event_trace_record_t;
+
+typedef uint32_t (*event_trace_clock_t)();
+
+// Safe from tasks and ISRs. The oldest records are overwritten once the ring wraps.
+void event_trace_record(event_trace_id_t id, uint16_t arg16, uint32_t arg32);
+
+// Copies the newest complete records, oldest first. Returns the number copied.
+size_t event_trace_snapshot(event_trace_record_t* records, size_t max_count);
+
+// Prints the ring as hex lines for tools/event_trace_decode.py.
+void event_trace_dump();
+
+// Linux target only: stamps records with another clock, such as a replay's virtual time. NULL restores the default.
+esp_err_t event_trace_set_clock(event_trace_clock_t clock);
@@ -0,0 +1,449 @@
+#define LOCAL_LOG_LEVEL ESP_LOG_INFO
+#include "esp_log.h"
+
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "esp_partition.h"
+#include "hydro_history.h"
+
+// Each flash sector is an independently decodable block: a header holding the first point,
+// followed by a bit stream of delta-of-delta timestamps and delta values, MSB first.
+//
+// Timestamp codes:  0 = same interval, 10 + 7 bit dod, 110 + 12 bit dod, 1110 + 32 bit dod,
+//                   11110 = pad to the next byte, 11111 = end (erased flash).
+// Value codes:      0 = unchanged, 10 + 4 bit delta, 110 + 7 bit delta, 111 + 16 bit absolute.
+
+#define SECTOR_SIZE 4096
+#define SECTOR_MAGIC 0x53494848
+#define HEADER_SIZE sizeof(sector_header_t)
+#define PAYLOAD_BYTES (SECTOR_SIZE - HEADER_SIZE)
+#define PAYLOAD_BITS (PAYLOAD_BYTES * 8)
+
+#define MAX_POINT_BITS (4 + 32 + 3 + 16)
+#define MAX_PAD_BITS (5 + 7)
+
+#define HISTORY_FLUSH_BYTES 32
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t first_timestamp;
+    uint16_t first_value;
+    uint16_t reserved;
+} sector_header_t;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t bit_pos;
+    uint32_t bit_len;
+    bool overrun;
+} bit_reader_t;
+
+typedef struct {
+    uint32_t timestamp;
+    int32_t delta;
+    uint16_t value;
+} decode_state_t;
+
+static const char *TAG = "HYDRO_HISTORY";
+
+static const esp_partition_t *partition;
+static uint32_t sector_count;
+static uint32_t used_sectors;
+static uint32_t head_sector;
+static uint32_t head_seq;
+static bool head_open;
+
+static uint8_t sector_buf[SECTOR_SIZE];
+static uint8_t query_buf[SECTOR_SIZE];
+static uint32_t bit_pos;
+static uint32_t flushed_bytes;
+static decode_state_t writer;
+static uint32_t appended;
+
+static void put_bits(uint32_t value, uint8_t count) {
+    // The buffer starts erased, so only zero bits need writing.
+    uint8_t *payload = sector_buf + HEADER_SIZE;
+    for(int8_t i = count - 1; i >= 0; i--) {
+        if(!((value >> i) & 1)) {
+            payload[bit_pos >> 3] &= ~(0x80 >> (bit_pos & 7));
+        }
+        bit_pos++;
+    }
+}
+
+static uint32_t get_bits(bit_reader_t *reader, uint8_t count) {
+    if(reader->bit_pos + count > reader->bit_len) {
+        reader->overrun = true;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < count; i++) {
+        uint32_t pos = reader->bit_pos++;
+        value = (value << 1) | ((reader->data[pos >> 3] >> (7 - (pos & 7))) & 1);
+    }
+
+    return value;
+}
+
+static int32_t get_signed(bit_reader_t *reader, uint8_t count) {
+    uint32_t value = get_bits(reader, count);
+    uint32_t sign = 1UL << (count - 1);
+
+    return (int32_t)((value ^ sign) - sign);
+}
+
+static uint8_t get_prefix(bit_reader_t *reader, uint8_t max_ones) {
+    uint8_t ones = 0;
+    while(ones < max_ones && get_bits(reader, 1) == 1) {
+        ones++;
+    }
+
+    return ones;
+}
+
+static bool decode_next(bit_reader_t *reader, decode_state_t *state) {
+    while(true) {
+        int32_t dod;
+        switch(get_prefix(reader, 5)) {
+            case 0:
+                dod = 0;
+                break;
+            case 1:
+                dod = get_signed(reader, 7);
+                break;
+            case 2:
+                dod = get_signed(reader, 12);
+                break;
+            case 3:
+                dod = (int32_t)get_bits(reader, 32);
+                break;
+            case 4:
+                reader->bit_pos = (reader->bit_pos + 7) & ~7UL;
+                continue;
+            default:
+                // Leave the reader on the end marker so the writer can resume there.
+                reader->bit_pos -= 5;
+                return false;
+        }
+
+        uint16_t value = state->value;
+        switch(get_prefix(reader, 3)) {
+            case 0:
+                break;
+            case 1:
+                value += get_signed(reader, 4);
+                break;
+            case 2:
+                value += get_signed(reader, 7);
+                break;
+            default:
+                value = get_bits(reader, 16);
+                break;
+        }
+
+        if(reader->overrun) {
+            return false;
+        }
+
+        state->delta += dod;
+        state->timestamp += state->delta;
+        state->value = value;
+
+        return true;
+    }
+}
+
+static void encode_point(uint32_t timestamp, uint16_t value) {
+    int32_t delta = (int32_t)(timestamp - writer.timestamp);
+    int32_t dod = delta - writer.delta;
+
+    if(dod == 0) {
+        put_bits(0, 1);
+    } else if(dod >= -64 && dod < 64) {
+        put_bits(0x2, 2);
+        put_bits(dod & 0x7f, 7);
+    } else if(dod >= -2048 && dod < 2048) {
+        put_bits(0x6, 3);
+        put_bits(dod & 0xfff, 12);
+    } else {
+        put_bits(0xe, 4);
+        put_bits((uint32_t)dod, 32);
+    }
+
+    int32_t value_delta = (int32_t)value - writer.value;
+    if(value_delta == 0) {
+        put_bits(0, 1);
+    } else if(value_delta >= -8 && value_delta < 8) {
+        put_bits(0x2, 2);
+        put_bits(value_delta & 0xf, 4);
+    } else if(value_delta >= -64 && value_delta < 64) {
+        put_bits(0x6, 3);
+        put_bits(value_delta & 0x7f, 7);
+    } else {
+        put_bits(0x7, 3);
+        put_bits(value, 16);
+    }
+
+    writer.timestamp = timestamp;
+    writer.delta = delta;
+    writer.value = value;
+}
+
+static uint32_t sector_offset(uint32_t sector) {
+    return sector * SECTOR_SIZE;
+}
+
+static esp_err_t read_header(uint32_t sector, sector_header_t *header) {
+    ERROR_CHECK_RETURN(esp_partition_read(partition, sector_offset(sector), header, HEADER_SIZE));
+
+    return header->magic == SECTOR_MAGIC ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t open_sector(uint32_t sector, uint32_t timestamp, uint16_t value) {
+    ERROR_CHECK_RETURN(esp_partition_erase_range(partition, sector_offset(sector), SECTOR_SIZE));
+
+    sector_header_t header = {
+        .magic = SECTOR_MAGIC,
+        .seq = head_seq + 1,
+        .first_timestamp = timestamp,
+        .first_value = value,
+        .reserved = 0xffff,
+    };
+
+    memset(sector_buf, 0xff, SECTOR_SIZE);
+    memcpy(sector_buf, &header, HEADER_SIZE);
+    ERROR_CHECK_RETURN(esp_partition_write(partition, sector_offset(sector), &header, HEADER_SIZE));
+
+    if(used_sectors < sector_count) {
+        used_sectors++;
+    }
+
+    head_sector = sector;
+    head_seq = header.seq;
+    head_open = true;
+    bit_pos = 0;
+    flushed_bytes = 0;
+    writer = (decode_state_t){
+        .timestamp = timestamp,
+        .delta = 0,
+        .value = value,
+    };
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_history_flush() {
+    if(!head_open) {
+        return ESP_OK;
+    }
+
+    // Pad to a byte boundary so no flushed byte ever needs rewriting.
+    if(bit_pos & 7) {
+        put_bits(0x1e, 5);
+        if(bit_pos & 7) {
+            put_bits(0, 8 - (bit_pos & 7));
+        }
+    }
+
+    uint32_t end_bytes = bit_pos >> 3;
+    if(end_bytes > flushed_bytes) {
+        ERROR_CHECK_RETURN(esp_partition_write(partition, sector_offset(head_sector) + HEADER_SIZE + flushed_bytes,
+                                               sector_buf + HEADER_SIZE + flushed_bytes, end_bytes - flushed_bytes));
+        flushed_bytes = end_bytes;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_history_append(uint32_t timestamp, uint16_t value) {
+    if(partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if(!head_open) {
+        ERROR_CHECK_RETURN(open_sector((head_sector + 1) % sector_count, timestamp, value));
+        appended++;
+        return ESP_OK;
+    }
+
+    if(timestamp < writer.timestamp) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(bit_pos + MAX_POINT_BITS + MAX_PAD_BITS > PAYLOAD_BITS) {
+        ERROR_CHECK_RETURN(hydro_history_flush());
+        ERROR_CHECK_RETURN(open_sector((head_sector + 1) % sector_count, timestamp, value));
+        appended++;
+        return ESP_OK;
+    }
+
+    encode_point(timestamp, value);
+    appended++;
+
+    if((bit_pos >> 3) - flushed_bytes >= HISTORY_FLUSH_BYTES) {
+        return hydro_history_flush();
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t resume_head(uint32_t sector, const sector_header_t *header) {
+    ERROR_CHECK_RETURN(esp_partition_read(partition, sector_offset(sector), sector_buf, SECTOR_SIZE));
+
+    bit_reader_t reader = {
+        .data = sector_buf + HEADER_SIZE,
+        .bit_len = PAYLOAD_BITS,
+    };
+    writer = (decode_state_t){
+        .timestamp = header->first_timestamp,
+        .value = header->first_value,
+    };
+
+    while(decode_next(&reader, &writer)) {
+    }
+
+    head_sector = sector;
+    head_seq = header->seq;
+
+    // Flushes always end byte aligned, anything else means a torn write so the next append starts a fresh sector.
+    bit_pos = reader.bit_pos;
+    head_open = !reader.overrun && (bit_pos & 7) == 0 && bit_pos + MAX_POINT_BITS + MAX_PAD_BITS <= PAYLOAD_BITS;
+    flushed_bytes = bit_pos >> 3;
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_history_init(const char *partition_label) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if(partition == NULL) {
+        ESP_LOGE(TAG, "partition \"%s\" not found", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_count = partition->size / SECTOR_SIZE;
+    used_sectors = 0;
+    head_sector = sector_count - 1;
+    head_seq = 0;
+    head_open = false;
+    appended = 0;
+
+    sector_header_t header;
+    sector_header_t newest_header = {0};
+    bool found = false;
+    for(uint32_t sector = 0; sector < sector_count; sector++) {
+        if(read_header(sector, &header) != ESP_OK) {
+            continue;
+        }
+
+        used_sectors++;
+        if(!found || header.seq > newest_header.seq) {
+            newest_header = header;
+            head_sector = sector;
+            found = true;
+        }
+    }
+
+    if(found) {
+        ERROR_CHECK_RETURN(resume_head(head_sector, &newest_header));
+    }
+
+    ESP_LOGI(TAG, "%" PRIu32 " of %" PRIu32 " sectors in use", used_sectors, sector_count);
+
+    return ESP_OK;
+}
+
+static uint32_t physical_sector(uint32_t logical) {
+    uint32_t oldest = (head_sector + sector_count - (used_sectors - 1)) % sector_count;
+
+    return (oldest + logical) % sector_count;
+}
+
+static esp_err_t collect_sector(uint32_t sector, uint32_t from, uint32_t to, hydro_history_point_t *points,
+                                size_t max_count, size_t *count, bool *past_end) {
+    bit_reader_t reader = {
+        .bit_len = PAYLOAD_BITS,
+    };
+
+    if(sector == head_sector && head_open) {
+        // The head sector may hold points that have not been flushed yet.
+        reader.data = sector_buf + HEADER_SIZE;
+        reader.bit_len = bit_pos;
+    } else {
+        ERROR_CHECK_RETURN(esp_partition_read(partition, sector_offset(sector), query_buf, SECTOR_SIZE));
+        reader.data = query_buf + HEADER_SIZE;
+    }
+
+    const sector_header_t *header = (const sector_header_t *)(reader.data - HEADER_SIZE);
+    decode_state_t state = {
+        .timestamp = header->first_timestamp,
+        .value = header->first_value,
+    };
+
+    do {
+        if(state.timestamp > to) {
+            *past_end = true;
+            return ESP_OK;
+        }
+
+        if(state.timestamp >= from) {
+            if(*count == max_count) {
+                *past_end = true;
+                return ESP_OK;
+            }
+
+            points[(*count)++] = (hydro_history_point_t){
+                .timestamp = state.timestamp,
+                .value = state.value,
+            };
+        }
+    } while(decode_next(&reader, &state));
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_history_query(uint32_t from, uint32_t to, hydro_history_point_t *points, size_t max_count, size_t *count_out) {
+    *count_out = 0;
+    if(partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if(used_sectors == 0) {
+        return ESP_OK;
+    }
+
+    // Sector start times increase in write order, so binary search for the last sector starting at or before from.
+    sector_header_t header;
+    uint32_t low = 0;
+    uint32_t high = used_sectors;
+    while(high - low > 1) {
+        uint32_t mid = (low + high) / 2;
+        ERROR_CHECK_RETURN(read_header(physical_sector(mid), &header));
+        if(header.first_timestamp <= from) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    bool past_end = false;
+    for(uint32_t logical = low; logical < used_sectors && !past_end; logical++) {
+        ERROR_CHECK_RETURN(collect_sector(physical_sector(logical), from, to, points, max_count, count_out, &past_end));
+    }
+
+    return ESP_OK;
+}
+
+uint32_t hydro_history_latest() {
+    return used_sectors > 0 ? writer.timestamp : 0;
+}
+
+void hydro_history_stats(uint32_t *used_sectors_out, uint32_t *total_sectors, uint32_t *appended_out) {
+    *used_sectors_out = used_sectors;
+    *total_sectors = sector_count;
+    *appended_out = appended;
+}
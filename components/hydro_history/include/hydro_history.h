@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    uint32_t timestamp;
+    uint16_t value;
+} hydro_history_point_t;
+
+// Mounts the circular log on a data partition and resumes after the newest stored point.
+esp_err_t hydro_history_init(const char* partition_label);
+
+// Timestamps must not go backwards. Costs at most one page write, plus one sector erase when a sector fills.
+esp_err_t hydro_history_append(uint32_t timestamp, uint16_t value);
+
+// Persists buffered points. Appends flush by themselves every HISTORY_FLUSH_BYTES of encoded data.
+esp_err_t hydro_history_flush();
+
+// Copies stored points with from <= timestamp <= to, oldest first.
+esp_err_t hydro_history_query(uint32_t from, uint32_t to, hydro_history_point_t* points, size_t max_count, size_t* count_out);
+
+// Timestamp of the newest stored point, 0 when the log is empty.
+uint32_t hydro_history_latest();
+
+// Sectors that hold data and the number of points appended since init.
+void hydro_history_stats(uint32_t* used_sectors, uint32_t* total_sectors, uint32_t* appended);
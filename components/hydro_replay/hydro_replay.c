@@ -0,0 +1,162 @@
+#define LOCAL_LOG_LEVEL ESP_LOG_INFO
+#include "esp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+#include "hydro_replay.h"
+#include "hydro_filter.h"
+#include "hydro_cali.h"
+#include "event_trace.h"
+
+#define READ_CHUNK_VALUES 4096
+
+static const char *TAG = "HYDRO_REPLAY";
+
+static FILE *trace_file;
+static uint16_t chunk[READ_CHUNK_VALUES];
+static size_t chunk_len;
+static size_t chunk_pos;
+static uint8_t primary_channel;
+
+static int64_t virtual_us;
+static struct timespec wall_start;
+static uint64_t sample_count;
+
+// Earliest raw sample at each level since the detector last changed level.
+static int64_t onset_us[HYDRO_LEVEL_COUNT];
+static hydro_level_t reported_level = HYDRO_LEVEL_ERR;
+static uint32_t change_count;
+static uint32_t latency_count;
+static int64_t latency_sum_us;
+static int64_t latency_max_us;
+
+static void reset_onsets() {
+    for(int i = 0; i < HYDRO_LEVEL_COUNT; i++) {
+        onset_us[i] = -1;
+    }
+}
+
+static uint32_t replay_clock() {
+    return (uint32_t)virtual_us;
+}
+
+static bool next_raw(uint16_t *raw) {
+    if(chunk_pos == chunk_len) {
+        chunk_len = fread(chunk, sizeof(uint16_t), READ_CHUNK_VALUES, trace_file);
+        chunk_pos = 0;
+        if(chunk_len == 0) {
+            return false;
+        }
+    }
+
+    // Traces are little endian, as is every target this runs on.
+    *raw = chunk[chunk_pos++];
+
+    return true;
+}
+
+static bool replay_source(uint8_t channel, int64_t timestamp_us, uint16_t *raw, void *ctx) {
+    if(!next_raw(raw)) {
+        return false;
+    }
+
+    virtual_us = timestamp_us;
+    sample_count++;
+
+    if(channel == primary_channel) {
+        hydro_level_t raw_level = hydro_level_for_mv(hydro_cali_mv(*raw));
+        if(onset_us[raw_level] < 0) {
+            onset_us[raw_level] = timestamp_us;
+        }
+    }
+
+    return true;
+}
+
+esp_err_t hydro_replay_open(const char *path, hydro_stream_config_t *config) {
+    if(path == NULL) {
+        ESP_LOGE(TAG, "no trace given");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    trace_file = fopen(path, "rb");
+    if(trace_file == NULL) {
+        ESP_LOGE(TAG, "cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    hydro_replay_header_t header;
+    if(fread(&header, sizeof(header), 1, trace_file) != 1 || header.magic != HYDRO_REPLAY_MAGIC
+       || header.sample_freq_hz == 0) {
+        ESP_LOGE(TAG, "%s is not a hydro trace", path);
+        fclose(trace_file);
+        trace_file = NULL;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(header.channel_count != config->channel_count) {
+        ESP_LOGE(TAG, "trace has %u channels, stream has %u", header.channel_count, config->channel_count);
+        fclose(trace_file);
+        trace_file = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    config->sample_freq_hz = header.sample_freq_hz;
+    primary_channel = config->channels[0];
+    reset_onsets();
+
+    esp_err_t ret = hydro_stream_set_mock_source(replay_source, NULL, true);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    event_trace_set_clock(replay_clock);
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    ESP_LOGI(TAG, "replaying %s at %" PRIu32 " Hz", path, header.sample_freq_hz);
+
+    return ESP_OK;
+}
+
+void hydro_replay_note_level(int64_t timestamp_us, hydro_level_t level) {
+    if(level == reported_level || level == HYDRO_LEVEL_ERR) {
+        return;
+    }
+
+    // A level the raw trace never reached, such as a trend escalation, has no onset to measure from.
+    int64_t onset = onset_us[level];
+    if(onset >= 0 && reported_level != HYDRO_LEVEL_ERR) {
+        int64_t latency_us = timestamp_us - onset;
+        latency_sum_us += latency_us;
+        latency_count++;
+        if(latency_us > latency_max_us) {
+            latency_max_us = latency_us;
+        }
+
+        printf("replay: level %d at %.3f s after %" PRId64 " ms\n", level, timestamp_us / 1e6, latency_us / 1000);
+    } else {
+        printf("replay: level %d at %.3f s\n", level, timestamp_us / 1e6);
+    }
+
+    reported_level = level;
+    change_count++;
+    reset_onsets();
+}
+
+void hydro_replay_finish() {
+    struct timespec wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    double virtual_s = virtual_us / 1e6;
+
+    printf("replay: %" PRIu64 " samples, %.1f s of trace in %.3f s (%.0fx, %.0f samples/s)\n",
+           sample_count, virtual_s, wall_s, virtual_s / wall_s, sample_count / wall_s);
+    printf("replay: %" PRIu32 " level changes, latency mean %" PRId64 " ms max %" PRId64 " ms over %" PRIu32 "\n",
+           change_count, latency_count > 0 ? latency_sum_us / latency_count / 1000 : 0, latency_max_us / 1000, latency_count);
+    fflush(stdout);
+
+    fclose(trace_file);
+    exit(sample_count > 0 ? 0 : 1);
+}
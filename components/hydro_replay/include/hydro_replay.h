@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esp_err.h"
+#include "hydro_sensor.h"
+#include "hydro_stream.h"
+#include <stdint.h>
+
+// "HRT1" in a little endian file.
+#define HYDRO_REPLAY_MAGIC 0x31545248
+
+// A recorded trace is this header followed by little endian raw ADC values, one per channel per scan
+// in the stream's channel order. tools/hydro_trace.py generates and converts them.
+typedef struct {
+    uint32_t magic;
+    uint32_t sample_freq_hz;
+    uint8_t channel_count;
+    uint8_t reserved[3];
+} hydro_replay_header_t;
+
+// Linux target only. Takes the trace's sample rate into config and feeds it to the stream in virtual time.
+esp_err_t hydro_replay_open(const char* path, hydro_stream_config_t* config);
+
+// Reports each level the detector acts on so decision latency can be measured against the raw trace.
+void hydro_replay_note_level(int64_t timestamp_us, hydro_level_t level);
+
+// Prints throughput and latency figures, then exits the process.
+void hydro_replay_finish();
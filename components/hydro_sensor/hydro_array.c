@@ -0,0 +1,67 @@
+#include "hydro_array.h"
+#include <string.h>
+#include "event_trace.h"
+
+esp_err_t hydro_array_init(hydro_array_t* array, const uint8_t* channels, uint8_t count, const hydro_filter_config_t* filter_config) {
+    if(count == 0 || count > HYDRO_STREAM_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(array, 0, sizeof(hydro_array_t));
+    memset(array->slot_for_channel, HYDRO_ARRAY_NO_SLOT, sizeof(array->slot_for_channel));
+
+    for(uint8_t i = 0; i < count; i++) {
+        if(channels[i] >= HYDRO_ARRAY_CHANNEL_SLOTS || array->slot_for_channel[channels[i]] != HYDRO_ARRAY_NO_SLOT) {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        esp_err_t ret = hydro_filter_init(&array->filters[i], filter_config);
+        if(ret != ESP_OK) {
+            return ret;
+        }
+
+        array->channels[i] = channels[i];
+        array->levels[i] = HYDRO_LEVEL_ERR;
+        array->slot_for_channel[channels[i]] = i;
+    }
+
+    array->count = count;
+
+    return ESP_OK;
+}
+
+uint32_t hydro_array_push(hydro_array_t* array, const hydro_sample_t* samples, size_t count) {
+    uint32_t changed = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        uint8_t channel = samples[i].channel;
+        uint8_t slot = channel < HYDRO_ARRAY_CHANNEL_SLOTS ? array->slot_for_channel[channel] : HYDRO_ARRAY_NO_SLOT;
+        if(slot == HYDRO_ARRAY_NO_SLOT) {
+            continue;
+        }
+
+        hydro_level_t level = hydro_filter_push(&array->filters[slot], samples[i].mv);
+        if(level != array->levels[slot]) {
+            array->levels[slot] = level;
+            changed |= 1UL << slot;
+            event_trace_record(TRACE_HYDRO_LEVEL, slot, level);
+        }
+    }
+
+    for(uint8_t slot = 0; slot < array->count; slot++) {
+        array->values[slot] = hydro_filter_value(&array->filters[slot]);
+    }
+
+    return changed;
+}
+
+hydro_level_t hydro_array_worst_level(const hydro_array_t* array) {
+    hydro_level_t worst = HYDRO_LEVEL_ERR;
+    for(uint8_t slot = 0; slot < array->count; slot++) {
+        if(array->levels[slot] > worst) {
+            worst = array->levels[slot];
+        }
+    }
+
+    return worst;
+}
@@ -0,0 +1,118 @@
+#define LOCAL_LOG_LEVEL ESP_LOG_INFO
+#include "esp_log.h"
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "hydro_cali.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+#define ADC_ATTEN ADC_ATTEN_DB_11
+#define NOMINAL_FULL_SCALE_MV 2500
+
+static bool cali_ready;
+static bool lut_ready;
+static uint16_t mv_lut[HYDRO_CALI_RAW_COUNT];
+
+#if !CONFIG_IDF_TARGET_LINUX
+static const char *TAG = "HYDRO_CALI";
+static adc_cali_handle_t cali_handle;
+#endif
+
+static uint16_t nominal_mv(uint16_t raw) {
+    return (uint32_t)raw * NOMINAL_FULL_SCALE_MV / HYDRO_CALI_RAW_COUNT;
+}
+
+static uint16_t convert_mv(uint16_t raw) {
+#if !CONFIG_IDF_TARGET_LINUX
+    int mv;
+    if(cali_handle != NULL && adc_cali_raw_to_voltage(cali_handle, raw, &mv) == ESP_OK) {
+        return mv;
+    }
+#endif
+
+    return nominal_mv(raw);
+}
+
+esp_err_t hydro_cali_init(uint8_t channel) {
+    if(cali_ready) {
+        return ESP_OK;
+    }
+
+#if !CONFIG_IDF_TARGET_LINUX
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .chan = channel,
+        .atten = ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_curve_fitting(&cali_config, &cali_handle);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_line_fitting(&cali_config, &cali_handle);
+#endif
+
+    if(ret == ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "no eFuse calibration, using nominal %d mV full scale", NOMINAL_FULL_SCALE_MV);
+        cali_handle = NULL;
+    } else if(ret != ESP_OK) {
+        return ret;
+    }
+#endif
+
+    cali_ready = true;
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_cali_build_lut(uint8_t channel) {
+    if(lut_ready) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = hydro_cali_init(channel);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    for(uint32_t raw = 0; raw < HYDRO_CALI_RAW_COUNT; raw++) {
+        mv_lut[raw] = convert_mv(raw);
+    }
+
+    lut_ready = true;
+
+    return ESP_OK;
+}
+
+uint16_t hydro_cali_mv(uint16_t raw) {
+    if(raw >= HYDRO_CALI_RAW_COUNT) {
+        raw = HYDRO_CALI_RAW_COUNT - 1;
+    }
+
+    return lut_ready ? mv_lut[raw] : convert_mv(raw);
+}
+
+uint16_t hydro_cali_raw_for_mv(uint16_t mv) {
+    // Calibrated curves are monotonic, so a binary search over raw codes finds the crossing.
+    uint32_t low = 0;
+    uint32_t high = HYDRO_CALI_RAW_COUNT;
+    while(low < high) {
+        uint32_t mid = (low + high) / 2;
+        if(hydro_cali_mv(mid) < mv) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
@@ -0,0 +1,125 @@
+#include "hydro_filter.h"
+#include <string.h>
+
+static const uint16_t level_thresholds[HYDRO_BOUNDARY_COUNT] = HYDRO_FILTER_THRESHOLDS;
+
+hydro_level_t hydro_level_for_mv(int mv) {
+    hydro_level_t level = HYDRO_LEVEL_OK;
+    for(int i = 0; i < HYDRO_BOUNDARY_COUNT; i++) {
+        if(mv <= level_thresholds[i]) {
+            level = (hydro_level_t)(i + 1);
+        }
+    }
+
+    return level;
+}
+
+esp_err_t hydro_level_band(const hydro_filter_config_t* config, hydro_level_t level, int32_t* low_mv, int32_t* high_mv) {
+    if(level < HYDRO_LEVEL_OK || level > HYDRO_LEVEL_HIGH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The same boundaries classify() applies while at level, so the drier edge carries the hysteresis.
+    *low_mv = level < HYDRO_LEVEL_HIGH ? config->thresholds[level] + 1 : -1;
+    *high_mv = level > HYDRO_LEVEL_OK ? config->thresholds[level - 1] + config->hysteresis[level - 1] : -1;
+
+    return ESP_OK;
+}
+
+static uint16_t median_push(hydro_filter_t* filter, uint16_t mv) {
+    uint8_t len = filter->config->median_len;
+    filter->median_window[filter->median_idx] = mv;
+    filter->median_idx = (filter->median_idx + 1) % len;
+    if(filter->median_fill < len) {
+        filter->median_fill++;
+    }
+
+    // Insertion sort of at most HYDRO_FILTER_MEDIAN_MAX values is cheaper than anything clever.
+    uint16_t sorted[HYDRO_FILTER_MEDIAN_MAX];
+    uint8_t count = filter->median_fill;
+    for(uint8_t i = 0; i < count; i++) {
+        uint16_t value = filter->median_window[i];
+        int8_t j = i - 1;
+        while(j >= 0 && sorted[j] > value) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = value;
+    }
+
+    return sorted[count / 2];
+}
+
+static hydro_level_t classify(const hydro_filter_t* filter, uint16_t value) {
+    hydro_level_t level = HYDRO_LEVEL_OK;
+    for(int i = 0; i < HYDRO_BOUNDARY_COUNT; i++) {
+        int32_t boundary = filter->config->thresholds[i];
+        if(filter->level > i) {
+            boundary += filter->config->hysteresis[i];
+        }
+
+        if(value <= boundary) {
+            level = (hydro_level_t)(i + 1);
+        }
+    }
+
+    return level;
+}
+
+esp_err_t hydro_filter_init(hydro_filter_t* filter, const hydro_filter_config_t* config) {
+    if(config->median_len == 0 || config->median_len > HYDRO_FILTER_MEDIAN_MAX || config->iir_shift > 15) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(filter, 0, sizeof(hydro_filter_t));
+    filter->config = config;
+    filter->level = HYDRO_LEVEL_ERR;
+    filter->candidate = HYDRO_LEVEL_ERR;
+
+    return ESP_OK;
+}
+
+hydro_level_t hydro_filter_push(hydro_filter_t* filter, uint16_t mv) {
+    int32_t sample_q8 = (int32_t)median_push(filter, mv) << 8;
+
+    if(!filter->primed || filter->config->iir_shift == 0) {
+        filter->iir_q8 = sample_q8;
+        filter->primed = true;
+    } else {
+        filter->iir_q8 += (sample_q8 - filter->iir_q8) >> filter->config->iir_shift;
+    }
+
+    hydro_level_t level = classify(filter, hydro_filter_value(filter));
+    if(filter->level == HYDRO_LEVEL_ERR) {
+        filter->level = level;
+        return level;
+    }
+
+    if(level == filter->level) {
+        filter->candidate = HYDRO_LEVEL_ERR;
+        filter->candidate_count = 0;
+        return filter->level;
+    }
+
+    if(level != filter->candidate) {
+        filter->candidate = level;
+        filter->candidate_count = 0;
+    }
+
+    filter->candidate_count++;
+    if(filter->candidate_count >= filter->config->dwell_samples[level]) {
+        filter->level = level;
+        filter->candidate = HYDRO_LEVEL_ERR;
+        filter->candidate_count = 0;
+    }
+
+    return filter->level;
+}
+
+uint16_t hydro_filter_value(const hydro_filter_t* filter) {
+    return (uint16_t)((filter->iir_q8 + (1 << 7)) >> 8);
+}
+
+hydro_level_t hydro_filter_level(const hydro_filter_t* filter) {
+    return filter->level;
+}
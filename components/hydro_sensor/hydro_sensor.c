@@ -1,25 +1,25 @@
 #define LOCAL_LOG_LEVEL ESP_LOG_INFO
 #include "esp_log.h"
 
+#include <stdlib.h>
+#include "sdkconfig.h"
+
 #include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
 #include "hydro_sensor.h"
+#include "hydro_filter.h"
+#include "hydro_cali.h"
+#include "event_trace.h"
 
-#define ADC_CHANNEL ADC_CHANNEL_0
 #define ADC_CONV_MODE ADC_CONV_SINGLE_UNIT_1
 #define ADC_ATTEN ADC_ATTEN_DB_11
 #define ADC_BIT_WIDTH ADC_BITWIDTH_12
 #define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
 
-#define ADC_MAX_VALUE (1UL<<ADC_BIT_WIDTH)
-
-#define LOW_LEVEL_THRESHOLD (ADC_MAX_VALUE * 15 / 16)
-#define MED_LEVEL_THRESHOLD (ADC_MAX_VALUE * 3 / 4)
-#define HIGH_LEVEL_THRESHOLD (ADC_MAX_VALUE / 2)
-
 static int adc_raw;
+static hydro_filter_t adc_filter;
+static const hydro_filter_config_t adc_filter_config = HYDRO_FILTER_POLL_CONFIG();
 static adc_oneshot_unit_handle_t adc1_handle;
+static adc_channel_t adc_channel;
 
 static const char *TAG = "HYDRO_SENSOR";
 
@@ -29,8 +29,15 @@ esp_err_t init_hydro_sensor() {
         return ESP_FAIL;
     }
 
+    adc_unit_t unit;
+    esp_err_t ret = adc_oneshot_io_to_channel(atoi(CONFIG_HYDRO_SENSOR_GPIO), &unit, &adc_channel);
+    if(ret != ESP_OK || unit != ADC_UNIT_1) {
+        ESP_LOGE(TAG, "hydro sensor GPIO must be on ADC1");
+        return ESP_ERR_INVALID_ARG;
+    }
+
     adc_oneshot_unit_init_cfg_t init_config1 = {.unit_id = ADC_UNIT_1};
-    esp_err_t ret = adc_oneshot_new_unit(&init_config1, &adc1_handle);
+    ret = adc_oneshot_new_unit(&init_config1, &adc1_handle);
     if(ret != ESP_OK) {
         return ret;
     }
@@ -40,38 +47,50 @@ esp_err_t init_hydro_sensor() {
         .atten = ADC_ATTEN
     };
 
-    ret = adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL, &chan_config);
+    ret = adc_oneshot_config_channel(adc1_handle, adc_channel, &chan_config);
     if(ret != ESP_OK) {
         return ret;
     }
 
-    return ESP_OK;
+    ret = hydro_cali_init(adc_channel);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Low: %d mV, Med: %d mV, High: %d mV", HYDRO_LOW_LEVEL_THRESHOLD, HYDRO_MED_LEVEL_THRESHOLD, HYDRO_HIGH_LEVEL_THRESHOLD);
+
+    return hydro_filter_init(&adc_filter, &adc_filter_config);
 }
 
 hydro_level_t read_hydro_sensor() {
 
-    esp_err_t ret = adc_oneshot_read(adc1_handle, ADC_CHANNEL, &adc_raw);
+    esp_err_t ret = adc_oneshot_read(adc1_handle, adc_channel, &adc_raw);
     if(ret != ESP_OK) {
         return HYDRO_LEVEL_ERR;
     }
 
-    ESP_LOGI(TAG, "Raw read: %d", adc_raw);
+    uint16_t mv = hydro_cali_mv(adc_raw);
+    event_trace_record(TRACE_HYDRO_READ, adc_raw, mv);
 
-    ESP_LOGI(TAG, "Low: %lu, Med: %lu, High: %lu", LOW_LEVEL_THRESHOLD, MED_LEVEL_THRESHOLD, HIGH_LEVEL_THRESHOLD);
+    hydro_level_t level = hydro_filter_push(&adc_filter, mv);
+    event_trace_record(TRACE_HYDRO_LEVEL, 0, level);
 
-    if(adc_raw > LOW_LEVEL_THRESHOLD) {
-        ESP_LOGI(TAG, "Reading ok");
-        return HYDRO_LEVEL_OK;
-    }
+    return level;
+}
 
-    if(adc_raw > MED_LEVEL_THRESHOLD) {
-        ESP_LOGI(TAG, "Reading low");
-        return HYDRO_LEVEL_LOW;
-    }
+uint16_t read_hydro_sensor_filtered_mv() {
+    return hydro_filter_value(&adc_filter);
+}
 
-    if(adc_raw > HIGH_LEVEL_THRESHOLD) {
-        return HYDRO_LEVEL_MED;
+esp_err_t read_hydro_sensor_mv(uint16_t* samples_mv, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        esp_err_t ret = adc_oneshot_read(adc1_handle, adc_channel, &adc_raw);
+        if(ret != ESP_OK) {
+            return ret;
+        }
+
+        samples_mv[i] = hydro_cali_mv(adc_raw);
     }
 
-    return HYDRO_LEVEL_HIGH;
+    return ESP_OK;
 }
@@ -0,0 +1,62 @@
+#include "hydro_sleep.h"
+
+#define SLEEP_STATE_MAGIC 0x48594452
+
+esp_err_t hydro_sleep_state_init(hydro_sleep_state_t* state, const hydro_sleep_config_t* config,
+                                 const hydro_filter_config_t* filter_config) {
+    if(config->interval_s == 0 || config->max_interval_s < config->interval_s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    state->magic = 0;
+    state->config = config;
+    state->wake_count = 0;
+    state->reported_level = HYDRO_LEVEL_ERR;
+    state->interval_s = config->interval_s;
+    state->since_report_s = 0;
+
+    esp_err_t ret = hydro_filter_init(&state->filter, filter_config);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    state->magic = SLEEP_STATE_MAGIC;
+
+    return ESP_OK;
+}
+
+bool hydro_sleep_state_valid(const hydro_sleep_state_t* state) {
+    return state->magic == SLEEP_STATE_MAGIC;
+}
+
+hydro_wake_action_t hydro_sleep_decide(hydro_sleep_state_t* state, const uint16_t* samples, size_t count) {
+    const hydro_sleep_config_t* config = state->config;
+    state->wake_count++;
+    // Only timer wakes land here, so the sleep that just ended ran its full interval.
+    if(state->wake_count > 1) {
+        state->since_report_s += state->interval_s;
+    }
+
+    hydro_level_t level = state->reported_level;
+    for(size_t i = 0; i < count; i++) {
+        level = hydro_filter_push(&state->filter, samples[i]);
+    }
+
+    // A wet probe keeps waking the cores so the alarm repeats, a dry one only on the way back to OK.
+    // Either way the backoff starts over, a leak that just dried up is the likeliest to come back.
+    if(level != state->reported_level || level > HYDRO_LEVEL_OK) {
+        state->reported_level = level;
+        state->interval_s = config->interval_s;
+        state->since_report_s = 0;
+        return HYDRO_WAKE_ALARM;
+    }
+
+    state->interval_s = state->interval_s > config->max_interval_s / 2 ? config->max_interval_s : state->interval_s * 2;
+
+    if(config->report_interval_s > 0 && state->since_report_s >= config->report_interval_s) {
+        state->since_report_s = 0;
+        return HYDRO_WAKE_REPORT;
+    }
+
+    return HYDRO_WAKE_SLEEP;
+}
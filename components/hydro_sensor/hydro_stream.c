@@ -0,0 +1,618 @@
+#define LOCAL_LOG_LEVEL ESP_LOG_INFO
+#include "esp_log.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/queue.h"
+#include "hydro_stream.h"
+#include "hydro_cali.h"
+#include "event_trace.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_timer.h"
+#include "esp_adc/adc_continuous.h"
+#include "soc/soc_caps.h"
+#if SOC_ADC_MONITOR_SUPPORTED
+#include "esp_adc/adc_monitor.h"
+#define USE_HW_MONITOR 1
+#endif
+#endif
+
+#define PRIMARY_CHANNEL (stream_config.channels[0])
+#define ADC_ATTEN ADC_ATTEN_DB_11
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type1.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type2.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type2.data)
+#endif
+
+#define TASK_N_QUIT (1UL << 0)
+#define TASK_N_CONV_DONE (1UL << 1)
+#define TASK_N_CROSSING (1UL << 2)
+
+#define EVENT_QUEUE_LEN 4
+
+#define ERROR_CHECK_RETURN(action) {esp_err_t ret = action; if(ret != ESP_OK) { return ret; }}
+
+static const char *TAG = "HYDRO_STREAM";
+
+static StreamBufferHandle_t sample_buffer;
+static TaskHandle_t stream_task_handle;
+static TaskHandle_t stop_waiter_handle;
+static hydro_sample_t *frame_samples;
+static hydro_stream_config_t stream_config;
+static uint32_t dropped_count;
+
+static QueueHandle_t event_queue;
+static volatile bool threshold_armed;
+static int32_t threshold_low_mv = -1;
+static int32_t threshold_high_mv = -1;
+
+#if CONFIG_IDF_TARGET_LINUX
+static hydro_stream_mock_source_t mock_source;
+static void *mock_source_ctx;
+static bool mock_virtual_time;
+static bool mock_ended;
+static uint64_t mock_sample_idx;
+#else
+static adc_continuous_handle_t adc_stream_handle;
+static uint8_t *conv_frame;
+static uint32_t conv_frame_size;
+#endif
+
+#if USE_HW_MONITOR
+static adc_monitor_handle_t monitor_handle;
+// Set by the monitor ISR, the stream task reports it with the first measured sample that follows.
+static volatile int8_t pending_crossing = -1;
+#endif
+
+static void push_samples(const hydro_sample_t *samples, size_t count) {
+    // Nobody reads while a threshold is armed, so the ring is kept empty rather than left to overflow.
+    // Only the stream task writes and the reader is waiting on the event queue, so the reset is safe here.
+    if(threshold_armed) {
+        xStreamBufferReset(sample_buffer);
+        return;
+    }
+
+    // Only whole samples may go into the stream buffer or the reader loses alignment.
+    size_t space = xStreamBufferSpacesAvailable(sample_buffer) / sizeof(hydro_sample_t);
+    if(count > space) {
+        dropped_count += count - space;
+        count = space;
+    }
+
+    if(count > 0) {
+        xStreamBufferSend(sample_buffer, samples, count * sizeof(hydro_sample_t), 0);
+    }
+}
+
+static void post_crossing(hydro_crossing_t crossing, const hydro_sample_t *sample) {
+    event_trace_record(TRACE_HYDRO_CROSSING, crossing, sample->mv);
+    hydro_threshold_event_t event = {
+        .timestamp_us = sample->timestamp_us,
+        .mv = sample->mv,
+        .crossing = crossing,
+    };
+    xQueueSend(event_queue, &event, 0);
+}
+
+// Software comparator used by the mock source and by targets without a digital monitor.
+static void check_thresholds(const hydro_sample_t *samples, size_t count) {
+    if(!threshold_armed) {
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        if(samples[i].channel != PRIMARY_CHANNEL) {
+            continue;
+        }
+
+        hydro_crossing_t crossing;
+        if(threshold_low_mv >= 0 && samples[i].mv < threshold_low_mv) {
+            crossing = HYDRO_CROSSED_BELOW;
+        } else if(threshold_high_mv >= 0 && samples[i].mv > threshold_high_mv) {
+            crossing = HYDRO_CROSSED_ABOVE;
+        } else {
+            continue;
+        }
+
+        threshold_armed = false;
+        post_crossing(crossing, &samples[i]);
+
+        return;
+    }
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+
+static int64_t mock_time_us() {
+    return (int64_t)(mock_sample_idx * 1000000 / stream_config.sample_freq_hz);
+}
+
+static void produce_mock_block() {
+    size_t count = 0;
+    while(count < stream_config.block_sample_count && !mock_ended) {
+        int64_t timestamp_us = mock_time_us();
+        uint8_t channel = stream_config.channels[mock_sample_idx % stream_config.channel_count];
+        uint16_t raw = 0;
+        if(mock_source != NULL && !mock_source(channel, timestamp_us, &raw, mock_source_ctx)) {
+            mock_ended = true;
+            break;
+        }
+
+        frame_samples[count++] = (hydro_sample_t){
+            .timestamp_us = timestamp_us,
+            .raw = raw,
+            .mv = hydro_cali_mv(raw),
+            .channel = channel,
+        };
+        mock_sample_idx++;
+    }
+
+    check_thresholds(frame_samples, count);
+    push_samples(frame_samples, count);
+}
+
+static void hydro_stream_task(void *args) {
+    uint32_t notification = 0;
+    TickType_t block_ticks = pdMS_TO_TICKS(stream_config.block_sample_count * 1000 / stream_config.sample_freq_hz);
+    if(block_ticks == 0) {
+        block_ticks = 1;
+    }
+
+    // In virtual time the reader produces blocks itself, so the task only waits to quit.
+    if(mock_virtual_time) {
+        block_ticks = portMAX_DELAY;
+    }
+
+    while(true) {
+        if(xTaskNotifyWait(0, UINT32_MAX, &notification, block_ticks) && (notification & TASK_N_QUIT)) {
+            break;
+        }
+
+        if(!mock_ended) {
+            produce_mock_block();
+        }
+    }
+
+    xTaskNotifyGive(stop_waiter_handle);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t stream_backend_start() {
+    mock_sample_idx = 0;
+    mock_ended = false;
+
+    return ESP_OK;
+}
+
+static esp_err_t stream_backend_stop() {
+    return ESP_OK;
+}
+
+static esp_err_t stream_backend_rearm() {
+    return ESP_OK;
+}
+
+#else
+
+#if USE_HW_MONITOR
+// The monitor only says a threshold was passed, so the event carries the next sample measured on the probe.
+static void post_pending_crossing(const hydro_sample_t *samples, size_t count) {
+    if(pending_crossing < 0) {
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        if(samples[i].channel == PRIMARY_CHANNEL) {
+            post_crossing(pending_crossing, &samples[i]);
+            pending_crossing = -1;
+            return;
+        }
+    }
+}
+#endif
+
+static bool IRAM_ATTR conv_done_isr(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data) {
+    BaseType_t must_yield = pdFALSE;
+    xTaskNotifyFromISR(stream_task_handle, TASK_N_CONV_DONE, eSetBits, &must_yield);
+
+    return must_yield == pdTRUE;
+}
+
+static void drain_conv_frames() {
+    uint32_t read_len = 0;
+
+    while(adc_continuous_read(adc_stream_handle, conv_frame, conv_frame_size, &read_len, 0) == ESP_OK) {
+        // The DMA frame has just completed, so back-date each sample from its position in the frame.
+        int64_t frame_end_us = esp_timer_get_time();
+        size_t result_count = read_len / SOC_ADC_DIGI_RESULT_BYTES;
+        size_t sample_count = 0;
+
+        for(size_t i = 0; i < result_count; i++) {
+            adc_digi_output_data_t *result = (adc_digi_output_data_t *)&conv_frame[i * SOC_ADC_DIGI_RESULT_BYTES];
+            if(ADC_GET_CHANNEL(result) >= SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)) {
+                continue;
+            }
+
+            uint16_t raw = ADC_GET_DATA(result);
+            frame_samples[sample_count++] = (hydro_sample_t){
+                .timestamp_us = frame_end_us - (int64_t)(result_count - 1 - i) * 1000000 / stream_config.sample_freq_hz,
+                .raw = raw,
+                .mv = hydro_cali_mv(raw),
+                .channel = ADC_GET_CHANNEL(result),
+            };
+        }
+
+#if USE_HW_MONITOR
+        post_pending_crossing(frame_samples, sample_count);
+#else
+        check_thresholds(frame_samples, sample_count);
+#endif
+        push_samples(frame_samples, sample_count);
+    }
+}
+
+static void hydro_stream_task(void *args) {
+    uint32_t notification = 0;
+
+    while(true) {
+        xTaskNotifyWait(0, UINT32_MAX, &notification, portMAX_DELAY);
+        if(notification & TASK_N_QUIT) {
+            break;
+        }
+
+        if(notification & (TASK_N_CONV_DONE | TASK_N_CROSSING)) {
+            drain_conv_frames();
+        }
+    }
+
+    xTaskNotifyGive(stop_waiter_handle);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t stream_backend_start() {
+    if(stream_config.channel_count > SOC_ADC_PATT_LEN_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    conv_frame_size = stream_config.block_sample_count * SOC_ADC_DIGI_RESULT_BYTES;
+    conv_frame = malloc(conv_frame_size);
+    if(conv_frame == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = conv_frame_size * 4,
+        .conv_frame_size = conv_frame_size,
+    };
+    ERROR_CHECK_RETURN(adc_continuous_new_handle(&handle_config, &adc_stream_handle));
+
+    // Every probe goes into one conversion pattern so a single DMA stream scans them all.
+    adc_digi_pattern_config_t patterns[HYDRO_STREAM_MAX_CHANNELS] = {0};
+    for(uint8_t i = 0; i < stream_config.channel_count; i++) {
+        patterns[i] = (adc_digi_pattern_config_t){
+            .atten = ADC_ATTEN,
+            .channel = stream_config.channels[i],
+            .unit = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+    }
+
+    adc_continuous_config_t dig_config = {
+        .pattern_num = stream_config.channel_count,
+        .adc_pattern = patterns,
+        .sample_freq_hz = stream_config.sample_freq_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_OUTPUT_TYPE,
+    };
+    ERROR_CHECK_RETURN(adc_continuous_config(adc_stream_handle, &dig_config));
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = conv_done_isr,
+    };
+    ERROR_CHECK_RETURN(adc_continuous_register_event_callbacks(adc_stream_handle, &cbs, NULL));
+
+    return adc_continuous_start(adc_stream_handle);
+}
+
+#if USE_HW_MONITOR
+
+static bool IRAM_ATTR crossing_from_isr(hydro_crossing_t crossing) {
+    if(!threshold_armed) {
+        return false;
+    }
+
+    threshold_armed = false;
+    pending_crossing = crossing;
+
+    BaseType_t must_yield = pdFALSE;
+    xTaskNotifyFromISR(stream_task_handle, TASK_N_CROSSING, eSetBits, &must_yield);
+
+    return must_yield == pdTRUE;
+}
+
+static bool IRAM_ATTR monitor_high_isr(adc_monitor_handle_t handle, const adc_monitor_evt_data_t *edata, void *user_data) {
+    return crossing_from_isr(HYDRO_CROSSED_ABOVE);
+}
+
+static bool IRAM_ATTR monitor_low_isr(adc_monitor_handle_t handle, const adc_monitor_evt_data_t *edata, void *user_data) {
+    return crossing_from_isr(HYDRO_CROSSED_BELOW);
+}
+
+static void monitor_delete() {
+    if(monitor_handle != NULL) {
+        adc_continuous_monitor_disable(monitor_handle);
+        adc_del_continuous_monitor(monitor_handle);
+        monitor_handle = NULL;
+    }
+}
+
+// The monitor fires above h_threshold, so it is the last raw code that still reads at or below high_mv.
+// A code of 0 is the floor, -1 would switch the high side off.
+static int32_t high_raw_threshold(int32_t high_mv) {
+    uint16_t raw = hydro_cali_raw_for_mv(high_mv + 1);
+
+    return raw > 0 ? raw - 1 : 0;
+}
+
+// Monitors can only be created while the continuous driver is stopped, so re-arming restarts conversion.
+static esp_err_t stream_backend_rearm() {
+    ERROR_CHECK_RETURN(adc_continuous_stop(adc_stream_handle));
+    monitor_delete();
+
+    // The monitor compares raw codes, so the mV window is mapped back through the calibration table.
+    adc_monitor_config_t monitor_config = {
+        .adc_unit = ADC_UNIT_1,
+        .channel = PRIMARY_CHANNEL,
+        .h_threshold = threshold_high_mv >= 0 ? high_raw_threshold(threshold_high_mv) : -1,
+        .l_threshold = threshold_low_mv >= 0 ? hydro_cali_raw_for_mv(threshold_low_mv) : -1,
+    };
+    ERROR_CHECK_RETURN(adc_new_continuous_monitor(adc_stream_handle, &monitor_config, &monitor_handle));
+
+    adc_monitor_evt_cbs_t cbs = {
+        .on_over_high_thresh = monitor_high_isr,
+        .on_below_low_thresh = monitor_low_isr,
+    };
+    ERROR_CHECK_RETURN(adc_continuous_monitor_register_event_callbacks(monitor_handle, &cbs, NULL));
+    ERROR_CHECK_RETURN(adc_continuous_monitor_enable(monitor_handle));
+
+    return adc_continuous_start(adc_stream_handle);
+}
+
+#else
+
+static esp_err_t stream_backend_rearm() {
+    return ESP_OK;
+}
+
+#endif
+
+static esp_err_t stream_backend_stop() {
+    if(adc_stream_handle != NULL) {
+        // Stop fails harmlessly when start never ran, deinit is what releases the unit.
+        adc_continuous_stop(adc_stream_handle);
+#if USE_HW_MONITOR
+        monitor_delete();
+#endif
+        ERROR_CHECK_RETURN(adc_continuous_deinit(adc_stream_handle));
+        adc_stream_handle = NULL;
+    }
+
+    free(conv_frame);
+    conv_frame = NULL;
+
+    return ESP_OK;
+}
+
+#endif
+
+static esp_err_t channel_for_gpio(int gpio, uint8_t *channel) {
+#if CONFIG_IDF_TARGET_LINUX
+    // The mock source has no pin mapping, GPIO numbers are used as channels directly.
+    *channel = gpio;
+
+    return ESP_OK;
+#else
+    adc_unit_t unit;
+    adc_channel_t adc_channel;
+    ERROR_CHECK_RETURN(adc_continuous_io_to_channel(gpio, &unit, &adc_channel));
+    if(unit != ADC_UNIT_1) {
+        ESP_LOGE(TAG, "GPIO %d is not on ADC1", gpio);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *channel = adc_channel;
+
+    return ESP_OK;
+#endif
+}
+
+esp_err_t hydro_stream_channels_from_gpios(const char *gpio_list, hydro_stream_config_t *config) {
+    uint8_t count = 0;
+    const char *cursor = gpio_list;
+
+    while(*cursor != '\0') {
+        char *end;
+        long gpio = strtol(cursor, &end, 10);
+        if(end == cursor || gpio < 0 || count == HYDRO_STREAM_MAX_CHANNELS) {
+            ESP_LOGE(TAG, "invalid GPIO list \"%s\"", gpio_list);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        ERROR_CHECK_RETURN(channel_for_gpio(gpio, &config->channels[count]));
+        count++;
+
+        cursor = end;
+        while(*cursor == ',' || *cursor == ' ') {
+            cursor++;
+        }
+    }
+
+    if(count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    config->channel_count = count;
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_stream_start(const hydro_stream_config_t *config) {
+    if(stream_task_handle != NULL) {
+        ESP_LOGE(TAG, "stream already started");
+        return ESP_FAIL;
+    }
+
+    if(config->sample_freq_hz == 0 || config->block_sample_count == 0 || config->ring_sample_count < config->block_sample_count
+       || config->channel_count == 0 || config->channel_count > HYDRO_STREAM_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = hydro_cali_build_lut(config->channels[0]);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    stream_config = *config;
+    dropped_count = 0;
+
+    sample_buffer = xStreamBufferCreate(stream_config.ring_sample_count * sizeof(hydro_sample_t),
+                                        stream_config.block_sample_count * sizeof(hydro_sample_t));
+    frame_samples = malloc(stream_config.block_sample_count * sizeof(hydro_sample_t));
+    event_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(hydro_threshold_event_t));
+    if(sample_buffer == NULL || frame_samples == NULL || event_queue == NULL) {
+        hydro_stream_stop();
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskCreate(hydro_stream_task, "Hydro Stream Task", 3072, NULL, 6, &stream_task_handle);
+
+    ret = stream_backend_start();
+    if(ret != ESP_OK) {
+        hydro_stream_stop();
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Streaming at %" PRIu32 " Hz", stream_config.sample_freq_hz);
+
+    return ESP_OK;
+}
+
+esp_err_t hydro_stream_stop() {
+    // The backend goes first so the conversion ISR never notifies a deleted task.
+    esp_err_t ret = stream_backend_stop();
+
+    if(stream_task_handle != NULL) {
+        stop_waiter_handle = xTaskGetCurrentTaskHandle();
+        xTaskNotify(stream_task_handle, TASK_N_QUIT, eSetBits);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        stream_task_handle = NULL;
+    }
+
+    if(sample_buffer != NULL) {
+        vStreamBufferDelete(sample_buffer);
+        sample_buffer = NULL;
+    }
+
+    if(event_queue != NULL) {
+        vQueueDelete(event_queue);
+        event_queue = NULL;
+    }
+
+    threshold_armed = false;
+    free(frame_samples);
+    frame_samples = NULL;
+
+    return ret;
+}
+
+size_t hydro_stream_read(hydro_sample_t *samples, size_t max_count, TickType_t timeout) {
+    if(sample_buffer == NULL) {
+        return 0;
+    }
+
+#if CONFIG_IDF_TARGET_LINUX
+    if(mock_virtual_time) {
+        if(xStreamBufferIsEmpty(sample_buffer) && !mock_ended) {
+            produce_mock_block();
+        }
+        timeout = 0;
+    }
+#endif
+
+    return xStreamBufferReceive(sample_buffer, samples, max_count * sizeof(hydro_sample_t), timeout) / sizeof(hydro_sample_t);
+}
+
+uint32_t hydro_stream_dropped_count() {
+    return dropped_count;
+}
+
+esp_err_t hydro_stream_arm_threshold(int32_t low_mv, int32_t high_mv) {
+    if(event_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    threshold_armed = false;
+    threshold_low_mv = low_mv;
+    threshold_high_mv = high_mv;
+#if USE_HW_MONITOR
+    pending_crossing = -1;
+#endif
+
+    esp_err_t ret = stream_backend_rearm();
+    xQueueReset(event_queue);
+    threshold_armed = ret == ESP_OK;
+
+    return ret;
+}
+
+bool hydro_stream_wait_event(hydro_threshold_event_t *event, TickType_t timeout) {
+    if(event_queue == NULL) {
+        return false;
+    }
+
+#if CONFIG_IDF_TARGET_LINUX
+    if(mock_virtual_time) {
+        int64_t deadline_us = timeout == portMAX_DELAY ? INT64_MAX : mock_time_us() + (int64_t)pdTICKS_TO_MS(timeout) * 1000;
+        while(uxQueueMessagesWaiting(event_queue) == 0 && !mock_ended && mock_time_us() < deadline_us) {
+            produce_mock_block();
+        }
+        timeout = 0;
+    }
+#endif
+
+    return xQueueReceive(event_queue, event, timeout) == pdTRUE;
+}
+
+esp_err_t hydro_stream_set_mock_source(hydro_stream_mock_source_t source, void *ctx, bool virtual_time) {
+#if CONFIG_IDF_TARGET_LINUX
+    if(stream_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mock_source = source;
+    mock_source_ctx = ctx;
+    mock_virtual_time = virtual_time;
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+bool hydro_stream_ended() {
+#if CONFIG_IDF_TARGET_LINUX
+    return mock_ended && sample_buffer != NULL && xStreamBufferIsEmpty(sample_buffer);
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,67 @@
+#include "hydro_trend.h"
+#include <string.h>
+
+#define MS_PER_MIN 60000
+
+esp_err_t hydro_trend_init(hydro_trend_t* trend, const hydro_trend_config_t* config) {
+    if(config->window < 3 || config->window > HYDRO_TREND_WINDOW_MAX || config->sample_period_ms == 0
+       || config->clear_mv_per_min > config->warn_mv_per_min) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(trend, 0, sizeof(hydro_trend_t));
+    trend->window = config->window;
+
+    // slope = (n * weighted_sum - sum(x) * sum) / (n^2 * (n^2 - 1) / 12) in mV per sample, so a rate in
+    // mV per minute compares against the numerator once scaled by that divisor and the sample period.
+    int64_t n = config->window;
+    int64_t slope_divisor = n * n * (n * n - 1) / 12;
+    trend->rate_divisor = slope_divisor * config->sample_period_ms;
+    trend->warn_limit = trend->rate_divisor * config->warn_mv_per_min;
+    trend->clear_limit = trend->rate_divisor * config->clear_mv_per_min;
+
+    return ESP_OK;
+}
+
+bool hydro_trend_push(hydro_trend_t* trend, uint16_t mv) {
+    uint8_t n = trend->window;
+
+    if(trend->fill < n) {
+        trend->weighted_sum += (int32_t)trend->fill * mv;
+        trend->sum += mv;
+        trend->samples[trend->idx] = mv;
+        trend->idx = (trend->idx + 1) % n;
+        trend->fill++;
+        if(trend->fill < n) {
+            return false;
+        }
+    } else {
+        // Dropping the oldest sample shifts every other weight down by one.
+        uint16_t oldest = trend->samples[trend->idx];
+        trend->weighted_sum += (int32_t)(n - 1) * mv - (trend->sum - oldest);
+        trend->sum += mv - oldest;
+        trend->samples[trend->idx] = mv;
+        trend->idx = (trend->idx + 1) % n;
+    }
+
+    // Positive while readings fall, which is the probe getting wetter.
+    int64_t sum_x = (int64_t)n * (n - 1) / 2;
+    trend->numerator = sum_x * trend->sum - (int64_t)n * trend->weighted_sum;
+
+    int64_t scaled = trend->numerator * MS_PER_MIN;
+    if(!trend->warning && scaled >= trend->warn_limit) {
+        trend->warning = true;
+    } else if(trend->warning && scaled < trend->clear_limit) {
+        trend->warning = false;
+    }
+
+    return trend->warning;
+}
+
+int32_t hydro_trend_rate_mv_per_min(const hydro_trend_t* trend) {
+    return (int32_t)(trend->numerator * MS_PER_MIN / trend->rate_divisor);
+}
+
+bool hydro_trend_warning(const hydro_trend_t* trend) {
+    return trend->warning;
+}
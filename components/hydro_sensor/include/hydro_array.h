@@ -0,0 +1,25 @@
+#pragma once
+
+#include "hydro_filter.h"
+#include "hydro_stream.h"
+
+#define HYDRO_ARRAY_CHANNEL_SLOTS 16
+#define HYDRO_ARRAY_NO_SLOT 0xff
+
+// Indexed by probe slot. The levels and values that get scanned across probes are parallel arrays, each
+// filter is kept whole since a sample updates all of one probe's filter state at once.
+typedef struct {
+    uint8_t count;
+    uint8_t channels[HYDRO_STREAM_MAX_CHANNELS];
+    uint16_t values[HYDRO_STREAM_MAX_CHANNELS];
+    int8_t levels[HYDRO_STREAM_MAX_CHANNELS];
+    hydro_filter_t filters[HYDRO_STREAM_MAX_CHANNELS];
+    uint8_t slot_for_channel[HYDRO_ARRAY_CHANNEL_SLOTS];
+} hydro_array_t;
+
+esp_err_t hydro_array_init(hydro_array_t* array, const uint8_t* channels, uint8_t count, const hydro_filter_config_t* filter_config);
+
+// Routes an interleaved scan block to each probe's filter. Returns a bitmask of slots whose level changed.
+uint32_t hydro_array_push(hydro_array_t* array, const hydro_sample_t* samples, size_t count);
+
+hydro_level_t hydro_array_worst_level(const hydro_array_t* array);
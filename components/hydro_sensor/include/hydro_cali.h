@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define HYDRO_CALI_RAW_COUNT 4096
+
+// Creates the calibration scheme for an ADC1 channel, falling back to a nominal linear map when eFuse data
+// is missing. There is one scheme, so the first call picks the channel and later calls reuse it.
+esp_err_t hydro_cali_init(uint8_t channel);
+
+// Precomputes millivolts for every raw code so hot paths skip the curve evaluation.
+esp_err_t hydro_cali_build_lut(uint8_t channel);
+
+uint16_t hydro_cali_mv(uint16_t raw);
+
+// Smallest raw code that reads at or above mv, used to program raw thresholds.
+uint16_t hydro_cali_raw_for_mv(uint16_t mv);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hydro_sensor.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HYDRO_LOW_LEVEL_THRESHOLD CONFIG_HYDRO_LOW_LEVEL_MV
+#define HYDRO_MED_LEVEL_THRESHOLD CONFIG_HYDRO_MED_LEVEL_MV
+#define HYDRO_HIGH_LEVEL_THRESHOLD CONFIG_HYDRO_HIGH_LEVEL_MV
+
+#define HYDRO_FILTER_MEDIAN_MAX 7
+#define HYDRO_BOUNDARY_COUNT HYDRO_LEVEL_HIGH
+#define HYDRO_LEVEL_COUNT (HYDRO_LEVEL_HIGH + 1)
+
+typedef struct {
+    // Odd window length, 1 disables the median stage.
+    uint8_t median_len;
+    // IIR smoothing factor of 1 / 2^iir_shift, 0 disables the IIR stage.
+    uint8_t iir_shift;
+    // Boundary i in mV separates level i from the wetter level i + 1, a value at or below it is the wetter level.
+    uint16_t thresholds[HYDRO_BOUNDARY_COUNT];
+    // Margin above boundary i needed to return to the drier side once past it.
+    uint16_t hysteresis[HYDRO_BOUNDARY_COUNT];
+    // Consecutive samples a new level must hold before it is reported, indexed by that level.
+    uint16_t dwell_samples[HYDRO_LEVEL_COUNT];
+} hydro_filter_config_t;
+
+typedef struct {
+    // Shared between filters on the same probe type, so it must outlive them.
+    const hydro_filter_config_t* config;
+    uint16_t median_window[HYDRO_FILTER_MEDIAN_MAX];
+    uint8_t median_idx;
+    uint8_t median_fill;
+    // Filtered value in Q8 fixed point.
+    int32_t iir_q8;
+    bool primed;
+    hydro_level_t level;
+    hydro_level_t candidate;
+    uint16_t candidate_count;
+} hydro_filter_t;
+
+#define HYDRO_FILTER_THRESHOLDS { HYDRO_LOW_LEVEL_THRESHOLD, HYDRO_MED_LEVEL_THRESHOLD, HYDRO_HIGH_LEVEL_THRESHOLD }
+
+// Tuned for one reading per poll period.
+#define HYDRO_FILTER_POLL_CONFIG() { \
+    .median_len = 3, \
+    .iir_shift = 1, \
+    .thresholds = HYDRO_FILTER_THRESHOLDS, \
+    .hysteresis = { 20, 20, 20 }, \
+    .dwell_samples = { 2, 1, 1, 1 }, \
+}
+
+// Tuned for kHz streams, dwell covers roughly 50 ms to leave and 20 ms to escalate at 1 kHz.
+#define HYDRO_FILTER_STREAM_CONFIG() { \
+    .median_len = 5, \
+    .iir_shift = 4, \
+    .thresholds = HYDRO_FILTER_THRESHOLDS, \
+    .hysteresis = { 20, 20, 20 }, \
+    .dwell_samples = { 50, 20, 20, 20 }, \
+}
+
+esp_err_t hydro_filter_init(hydro_filter_t* filter, const hydro_filter_config_t* config);
+
+hydro_level_t hydro_filter_push(hydro_filter_t* filter, uint16_t mv);
+
+uint16_t hydro_filter_value(const hydro_filter_t* filter);
+
+hydro_level_t hydro_filter_level(const hydro_filter_t* filter);
+
+// mV range that keeps a filter with this config at level, -1 where the band is open ended.
+esp_err_t hydro_level_band(const hydro_filter_config_t* config, hydro_level_t level, int32_t* low_mv, int32_t* high_mv);
@@ -2,6 +2,8 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 typedef enum {
     HYDRO_LEVEL_ERR = -1,
@@ -14,3 +16,11 @@ typedef enum {
 esp_err_t init_hydro_sensor();
 
 hydro_level_t read_hydro_sensor();
+
+// Filtered value behind the last level returned by read_hydro_sensor.
+uint16_t read_hydro_sensor_filtered_mv();
+
+// Unfiltered burst of calibrated oneshot reads from the first probe.
+esp_err_t read_hydro_sensor_mv(uint16_t* samples_mv, size_t count);
+
+hydro_level_t hydro_level_for_mv(int mv);
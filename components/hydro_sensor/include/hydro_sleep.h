@@ -0,0 +1,46 @@
+#pragma once
+
+#include "hydro_filter.h"
+
+typedef enum {
+    HYDRO_WAKE_SLEEP = 0,
+    HYDRO_WAKE_ALARM,
+    HYDRO_WAKE_REPORT,
+} hydro_wake_action_t;
+
+typedef struct {
+    // Sleep after a wake that saw a wet probe or a level change.
+    uint32_t interval_s;
+    // A steady dry probe doubles the sleep each wake up to this.
+    uint32_t max_interval_s;
+    // Time asleep after which a steady dry probe still wakes the cores to report, 0 never does.
+    uint32_t report_interval_s;
+} hydro_sleep_config_t;
+
+// Lives in RTC memory between deep sleep cycles. The config pointers stay valid because the
+// image, and so its rodata, is unchanged across a deep sleep.
+typedef struct {
+    uint32_t magic;
+    const hydro_sleep_config_t* config;
+    uint32_t wake_count;
+    hydro_level_t reported_level;
+    // Length of the coming sleep, and the time slept since the cores last ran.
+    uint32_t interval_s;
+    uint32_t since_report_s;
+    hydro_filter_t filter;
+} hydro_sleep_state_t;
+
+#define HYDRO_SLEEP_DEFAULT_CONFIG() { \
+    .interval_s = CONFIG_HYDRO_SLEEP_INTERVAL_S, \
+    .max_interval_s = CONFIG_HYDRO_SLEEP_MAX_INTERVAL_S, \
+    .report_interval_s = CONFIG_HYDRO_SLEEP_REPORT_INTERVAL_S, \
+}
+
+esp_err_t hydro_sleep_state_init(hydro_sleep_state_t* state, const hydro_sleep_config_t* config,
+                                 const hydro_filter_config_t* filter_config);
+
+bool hydro_sleep_state_valid(const hydro_sleep_state_t* state);
+
+// Feeds a wake's sample burst through the retained filter, decides whether the main cores are
+// needed and sets interval_s for the next sleep.
+hydro_wake_action_t hydro_sleep_decide(hydro_sleep_state_t* state, const uint16_t* samples, size_t count);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+    int64_t timestamp_us;
+    uint16_t raw;
+    uint16_t mv;
+    uint8_t channel;
+} hydro_sample_t;
+
+#define HYDRO_STREAM_MAX_CHANNELS 8
+
+typedef struct {
+    // Total conversions per second, shared round robin between the channels.
+    uint32_t sample_freq_hz;
+    size_t ring_sample_count;
+    size_t block_sample_count;
+    uint8_t channel_count;
+    uint8_t channels[HYDRO_STREAM_MAX_CHANNELS];
+} hydro_stream_config_t;
+
+#define HYDRO_STREAM_DEFAULT_CONFIG() { \
+    .sample_freq_hz = CONFIG_HYDRO_STREAM_SAMPLE_FREQ_HZ, \
+    .ring_sample_count = CONFIG_HYDRO_STREAM_RING_SAMPLES, \
+    .block_sample_count = CONFIG_HYDRO_STREAM_BLOCK_SAMPLES, \
+    .channel_count = 1, \
+    .channels = { 0 }, \
+}
+
+typedef enum {
+    HYDRO_CROSSED_BELOW = 0,
+    HYDRO_CROSSED_ABOVE,
+} hydro_crossing_t;
+
+// The first sample measured on the probe at or after the crossing, unfiltered.
+typedef struct {
+    int64_t timestamp_us;
+    uint16_t mv;
+    hydro_crossing_t crossing;
+} hydro_threshold_event_t;
+
+// Mock sources produce the raw value for a sample on the linux target. Returning false ends the stream.
+typedef bool (*hydro_stream_mock_source_t)(uint8_t channel, int64_t timestamp_us, uint16_t* raw, void* ctx);
+
+// Fills channels from a comma separated GPIO list such as CONFIG_HYDRO_SENSOR_GPIO.
+esp_err_t hydro_stream_channels_from_gpios(const char* gpio_list, hydro_stream_config_t* config);
+
+esp_err_t hydro_stream_start(const hydro_stream_config_t* config);
+
+esp_err_t hydro_stream_stop();
+
+// Blocks until a full block is buffered or timeout passes. Returns the number of samples copied.
+size_t hydro_stream_read(hydro_sample_t* samples, size_t max_count, TickType_t timeout);
+
+uint32_t hydro_stream_dropped_count();
+
+// In virtual time blocks are produced when the reader asks for them rather than at the sample rate,
+// and timeouts count sample time, so a replay runs as fast as the pipeline consumes it.
+esp_err_t hydro_stream_set_mock_source(hydro_stream_mock_source_t source, void* ctx, bool virtual_time);
+
+// True once a mock source has run out and everything it produced has been read.
+bool hydro_stream_ended();
+
+// Fires one event when a sample on the first channel goes below low_mv or above high_mv, -1 disables a side.
+// The trigger disarms itself after firing and must be re-armed for the next window. Samples are discarded
+// while it is armed, reading resumes with the block the crossing was found in.
+esp_err_t hydro_stream_arm_threshold(int32_t low_mv, int32_t high_mv);
+
+bool hydro_stream_wait_event(hydro_threshold_event_t* event, TickType_t timeout);
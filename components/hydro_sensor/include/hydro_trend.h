@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HYDRO_TREND_WINDOW_MAX 64
+
+typedef struct {
+    // Samples in the regression window, from 3 to HYDRO_TREND_WINDOW_MAX.
+    uint8_t window;
+    // Spacing of the pushed samples, the estimator assumes it is steady.
+    uint32_t sample_period_ms;
+    // Wetting (falling mV) rate that raises the warning, and the rate it must drop below to clear it.
+    uint16_t warn_mv_per_min;
+    uint16_t clear_mv_per_min;
+} hydro_trend_config_t;
+
+// Least squares slope over a sliding window, updated from running sums in O(1) per sample.
+typedef struct {
+    uint16_t samples[HYDRO_TREND_WINDOW_MAX];
+    uint8_t window;
+    uint8_t idx;
+    uint8_t fill;
+    // Sum of the window and the sum weighted by age, 0 for the oldest sample.
+    int32_t sum;
+    int32_t weighted_sum;
+    // Rate limits pre-scaled to the regression numerator so a push needs no division.
+    int64_t warn_limit;
+    int64_t clear_limit;
+    int64_t rate_divisor;
+    int64_t numerator;
+    bool warning;
+} hydro_trend_t;
+
+#define HYDRO_TREND_DEFAULT_CONFIG(period_ms) { \
+    .window = CONFIG_HYDRO_TREND_WINDOW_SAMPLES, \
+    .sample_period_ms = (period_ms), \
+    .warn_mv_per_min = CONFIG_HYDRO_TREND_WARN_MV_PER_MIN, \
+    .clear_mv_per_min = CONFIG_HYDRO_TREND_WARN_MV_PER_MIN / 2, \
+}
+
+esp_err_t hydro_trend_init(hydro_trend_t* trend, const hydro_trend_config_t* config);
+
+// Returns whether the early warning is raised. It stays clear until the window has filled.
+bool hydro_trend_push(hydro_trend_t* trend, uint16_t mv);
+
+// Current wetting rate in mV per minute, negative while the probe dries.
+int32_t hydro_trend_rate_mv_per_min(const hydro_trend_t* trend);
+
+bool hydro_trend_warning(const hydro_trend_t* trend);
@@ -0,0 +1,89 @@
+#include "host_test.h"
+#include "buzzer_synth.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Per-tick cost of the GPTimer ISR's sample step: the play position math the ISR used before the phase
+// accumulator, the bare accumulator, and buzzer_voice_tick() as it ships with the frame countdown. Each writes
+// its output to a volatile the way the ISR writes the pin or modulator. Cycles are the host's TSC where there
+// is one and only compare the three, they are not device figures: on the C3 the position math also takes a
+// remu and a divu every tick. Also reports the pitch each one actually produces.
+#define NOTE_HZ 1047
+
+static volatile int output;
+
+static uint64_t cycles() {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// The ISR body before the phase accumulator, with its 255 entry square table.
+static bool square_255[255];
+static uint32_t play_pos;
+static uint32_t half_period_ticks;
+
+static __attribute__((noinline)) int position_tick() {
+    play_pos = (play_pos + 1) % (half_period_ticks * 2);
+    uint32_t play_progress = (play_pos * 0xff) / (half_period_ticks * 2);
+    return output = square_255[play_progress];
+}
+
+static uint32_t phase_acc;
+static uint32_t phase_inc;
+
+static __attribute__((noinline)) int phase_tick() {
+    phase_acc += phase_inc;
+    return output = wave_square[phase_acc >> WAVE_PHASE_SHIFT] > 0;
+}
+
+static buzzer_voice_t voice;
+
+static __attribute__((noinline)) int voice_tick() {
+    int8_t density;
+    if(buzzer_voice_tick(&voice, &density)) {
+        voice.frame_ticks_left = UINT32_MAX;
+    }
+    return output = density > 0;
+}
+
+static void bench(const char* name, int (*tick)(), long ticks) {
+    int last = tick();
+    long rising_edges = 0;
+
+    int64_t start_ns = host_time_ns();
+    uint64_t start_cycles = cycles();
+    for(long i = 0; i < ticks; i++) {
+        int level = tick();
+        rising_edges += level && !last;
+        last = level;
+    }
+    double tick_cycles = (double)(cycles() - start_cycles) / ticks;
+    double tick_ns = (double)(host_time_ns() - start_ns) / ticks;
+    double hz = (double)rising_edges * ISR_RATE_HZ / ticks;
+
+    printf("%-18s %5.2f ns/tick %6.2f cycles/tick, %7.1f Hz for %d Hz\n", name, tick_ns, tick_cycles, hz, NOTE_HZ);
+    CHECK(rising_edges > 0);
+}
+
+int main(int argc, char** argv) {
+    long ticks = host_bench_iterations(argc, argv, 20000000);
+
+    for(int i = 0; i < 255; i++) {
+        square_255[i] = i <= 127;
+    }
+    half_period_ticks = ISR_RATE_HZ / (2 * NOTE_HZ);
+    phase_inc = (uint32_t)(((uint64_t)NOTE_HZ << 32) / ISR_RATE_HZ);
+    buzzer_keyframe_t keyframe = { .frequency = NOTE_HZ, .duration = UINT16_MAX };
+    buzzer_voice_start_frame(&voice, &keyframe, BUZZER_WAV_SQUARE);
+
+    bench("position math", position_tick, ticks);
+    bench("phase accumulator", phase_tick, ticks);
+    bench("buzzer_voice_tick", voice_tick, ticks);
+
+    return host_test_result();
+}
@@ -0,0 +1,45 @@
+#include "host_test.h"
+#include "buzzer_music.h"
+#include "buzzer_pattern_pool.h"
+#include <string.h>
+
+// Parse throughput of a tune using every command, through the bare parser and through parse_music_str(), which
+// adds the pool reservation, the trim and the destroy.
+static const char tune[] = "t180o5l4cdefgab o6c[o5l2gfedc r1]4 l8c.d16e.f16g.a16b.o6c16";
+
+int main(int argc, char** argv) {
+    long iterations = host_bench_iterations(argc, argv, 1000000);
+    size_t len = strlen(tune);
+
+    static buzzer_keyframe_t frames[512];
+    size_t frame_count = 0;
+    int64_t start_ns = host_time_ns();
+    for(long i = 0; i < iterations; i++) {
+        buzzer_music_parser_t parser;
+        buzzer_music_parser_init(&parser, frames, 512);
+        buzzer_music_parser_feed(&parser, tune, len);
+        if(buzzer_music_parser_finish(&parser) != ESP_OK) {
+            printf("parse failed: %s\n", parser.err_msg);
+            return 1;
+        }
+        frame_count = parser.frame_count;
+    }
+    int64_t parser_ns = host_time_ns() - start_ns;
+
+    start_ns = host_time_ns();
+    for(long i = 0; i < iterations; i++) {
+        buzzer_pattern_t* pattern;
+        if(parse_music_str(tune, &pattern) != ESP_OK) {
+            printf("parse_music_str failed\n");
+            return 1;
+        }
+        buzzer_pattern_destroy(pattern);
+    }
+    int64_t pattern_ns = host_time_ns() - start_ns;
+
+    printf("buzzer_music: %zu chars to %zu keyframes\n", len, frame_count);
+    printf("parser %.0f ns/tune, %.1f MB/s\n", (double)parser_ns / iterations, (double)len * iterations * 1000 / parser_ns);
+    printf("parse_music_str with the pool %.0f ns/tune\n", (double)pattern_ns / iterations);
+
+    return 0;
+}
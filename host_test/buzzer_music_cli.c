@@ -0,0 +1,29 @@
+#include "buzzer_music.h"
+#include <stdio.h>
+#include <string.h>
+
+// Parses one music string per stdin line for mml_diff.py. Prints the keyframes as frequency/duration pairs,
+// or E and the error position.
+int main() {
+    static char line[4096];
+    static buzzer_keyframe_t frames[512];
+
+    while(fgets(line, sizeof(line), stdin) != NULL) {
+        size_t len = strcspn(line, "\n");
+
+        buzzer_music_parser_t parser;
+        buzzer_music_parser_init(&parser, frames, sizeof(frames) / sizeof(frames[0]));
+        buzzer_music_parser_feed(&parser, line, len);
+        if(buzzer_music_parser_finish(&parser) != ESP_OK) {
+            printf("E%zu\n", parser.err_pos);
+            continue;
+        }
+
+        for(size_t i = 0; i < parser.frame_count; i++) {
+            printf("%s%u/%u", i > 0 ? " " : "", frames[i].frequency, frames[i].duration);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
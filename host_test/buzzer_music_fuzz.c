@@ -0,0 +1,106 @@
+#include "host_test.h"
+#include "buzzer_music.h"
+#include "buzzer_pattern_pool.h"
+#include "esp_log.h"
+#include <string.h>
+
+// Fuzz target for the music parser. With -DHOST_TEST_LIBFUZZER=ON under clang it is a libFuzzer target, otherwise
+// main() feeds it random strings over the parser's alphabet, which is what ctest runs. Checks that:
+//   - feeding in chunks gives the same frames or the same error as feeding the whole string,
+//   - errors point inside the string and results fit the buffer,
+//   - parse_music_str() agrees with the parser and hands its pool blocks back.
+#define MAX_FRAMES 512
+
+#define FUZZ_ASSERT(cond, music) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: %s failed for \"%s\"\n", __FILE__, __LINE__, #cond, music); \
+        abort(); \
+    } \
+} while(0)
+
+static esp_err_t parse_chunked(buzzer_music_parser_t* parser, const char* music, size_t len, size_t chunk_seed) {
+    for(size_t i = 0; i < len;) {
+        size_t chunk = 1 + (chunk_seed + i) % 7;
+        if(chunk > len - i) {
+            chunk = len - i;
+        }
+        buzzer_music_parser_feed(parser, music + i, chunk);
+        i += chunk;
+    }
+
+    return buzzer_music_parser_finish(parser);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static buzzer_keyframe_t whole_frames[MAX_FRAMES];
+    static buzzer_keyframe_t chunked_frames[MAX_FRAMES];
+    static char music[4096];
+    if(size >= sizeof(music)) {
+        return 0;
+    }
+    memcpy(music, data, size);
+    music[size] = '\0';
+    size_t len = strlen(music);
+
+    buzzer_music_parser_t whole;
+    buzzer_music_parser_init(&whole, whole_frames, MAX_FRAMES);
+    buzzer_music_parser_feed(&whole, music, len);
+    esp_err_t err = buzzer_music_parser_finish(&whole);
+
+    buzzer_music_parser_t chunked;
+    buzzer_music_parser_init(&chunked, chunked_frames, MAX_FRAMES);
+    FUZZ_ASSERT(parse_chunked(&chunked, music, len, size > 0 ? data[0] : 0) == err, music);
+    FUZZ_ASSERT(whole.frame_count <= MAX_FRAMES, music);
+    if(err == ESP_OK) {
+        FUZZ_ASSERT(chunked.frame_count == whole.frame_count, music);
+        FUZZ_ASSERT(memcmp(whole_frames, chunked_frames, whole.frame_count * sizeof(buzzer_keyframe_t)) == 0, music);
+    } else {
+        FUZZ_ASSERT(chunked.err_pos == whole.err_pos, music);
+        FUZZ_ASSERT(whole.err_pos <= len && whole.err_msg != NULL, music);
+    }
+
+    buzzer_pattern_t* pattern = NULL;
+    FUZZ_ASSERT(parse_music_str(music, &pattern) == err, music);
+    if(err == ESP_OK) {
+        FUZZ_ASSERT(pattern->frame_count == (int)whole.frame_count, music);
+        FUZZ_ASSERT(memcmp(pattern->key_frames, whole_frames, whole.frame_count * sizeof(buzzer_keyframe_t)) == 0, music);
+        buzzer_pattern_destroy(pattern);
+    }
+
+    size_t patterns_used, frames_used;
+    buzzer_pattern_pool_stats(&patterns_used, &frames_used);
+    FUZZ_ASSERT(patterns_used == 0 && frames_used == 0, music);
+
+    return 0;
+}
+
+int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    return 0;
+}
+
+#ifndef HOST_TEST_LIBFUZZER
+
+// Mostly valid commands with the odd stray character, so inputs get deep into the grammar.
+static const char alphabet[] = "abcdefgrolt[]#$.0123456789 abcdefgr[]123 x";
+
+int main(int argc, char** argv) {
+    long runs = host_bench_iterations(argc, argv, 300000);
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    srand(1);
+    uint8_t input[64];
+    for(long r = 0; r < runs; r++) {
+        size_t size = rand() % sizeof(input);
+        for(size_t i = 0; i < size; i++) {
+            input[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    printf("buzzer_music_fuzz: %ld random strings\n", runs);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "host_test.h"
+#include "buzzer_music.h"
+#include "buzzer_pattern_pool.h"
+#include "esp_log.h"
+#include <malloc.h>
+
+// Keeps up to HELD runtime patterns alive while replacing one per cycle with a parsed tune or a sweep, the way
+// the alarms churn them. The heap must not move and the pools must be empty again at the end.
+#define HELD 6
+
+static const char* const tunes[] = {"o4l2cr2c", "o5l2co4f#", "l4o6cf#o7co6f#c", "o5l4cego6c", "o4l2cz"};
+
+int main(int argc, char** argv) {
+    long cycles = host_bench_iterations(argc, argv, 2000000);
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    buzzer_pattern_t* held[HELD] = {0};
+    size_t heap_before = mallinfo2().uordblks;
+    size_t heap_peak = heap_before;
+    long failed = 0;
+
+    int64_t start_ns = host_time_ns();
+    for(long i = 0; i < cycles; i++) {
+        int k = i % HELD;
+        if(held[k] != NULL) {
+            buzzer_pattern_destroy(held[k]);
+            held[k] = NULL;
+        }
+
+        // The last tune has a bad note, so some parses fail part way and must hand their blocks back.
+        esp_err_t ret = i % 3 == 0 ? buzzer_frequency_sweep(200, 4000, 1 + i % 60, 500, &held[k])
+                                   : parse_music_str(tunes[i % 5], &held[k]);
+        if(ret != ESP_OK) {
+            held[k] = NULL;
+            failed++;
+        }
+
+        size_t heap = mallinfo2().uordblks;
+        if(heap > heap_peak) {
+            heap_peak = heap;
+        }
+    }
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+
+    for(int k = 0; k < HELD; k++) {
+        if(held[k] != NULL) {
+            buzzer_pattern_destroy(held[k]);
+        }
+    }
+    size_t patterns_used, frames_used;
+    buzzer_pattern_pool_stats(&patterns_used, &frames_used);
+
+    printf("buzzer_pattern_pool: %ld create/destroy cycles, %ld failed, %.1f ns/cycle\n", cycles, failed,
+           (double)elapsed_ns / cycles);
+    printf("heap %zu bytes before, %zu peak, pool left %zu patterns %zu frames\n", heap_before, heap_peak,
+           patterns_used, frames_used);
+
+    CHECK_EQ(heap_peak, heap_before);
+    CHECK_EQ(patterns_used, 0);
+    CHECK_EQ(frames_used, 0);
+    CHECK(failed < cycles);
+
+    return host_test_result();
+}
@@ -0,0 +1,38 @@
+#include "host_test.h"
+#include "buzzer_music.h"
+#include "buzzer_render.h"
+
+// Render rate of each waveform through the shared tick and frame stepping, which is also the per-tick work of
+// the GPTimer ISR apart from the modulator write. Reported against the 50 kHz the ISR has to keep up with.
+static const char* const waveform_names[] = {"square", "sin", "saw"};
+
+int main(int argc, char** argv) {
+    long passes = host_bench_iterations(argc, argv, 20);
+
+    buzzer_pattern_t* pattern;
+    if(parse_music_str("t240o4l4cdefgab o5c[o4l2gfedc r1]2 l8c.d16e.f16g.a16b.o5c16", &pattern) != ESP_OK) {
+        return 1;
+    }
+
+    size_t max_samples = buzzer_render_sample_count(pattern, passes);
+    int16_t* samples = malloc(max_samples * sizeof(int16_t));
+    size_t count;
+    // Untimed first pass, so page faults on the buffer don't land on the first waveform.
+    buzzer_render_pattern(pattern, passes, samples, max_samples, &count);
+    for(int waveform = BUZZER_WAV_SQUARE; waveform <= BUZZER_WAV_SAW; waveform++) {
+        pattern->waveform = waveform;
+
+        int64_t start_ns = host_time_ns();
+        buzzer_render_pattern(pattern, passes, samples, max_samples, &count);
+        int64_t elapsed_ns = host_time_ns() - start_ns;
+
+        printf("buzzer_render %s: %zu samples, %.1f Msamples/s, %.2f ns/sample, %.0fx real time\n",
+               waveform_names[waveform], count, (double)count * 1000 / elapsed_ns, (double)elapsed_ns / count,
+               (double)count / BUZZER_RENDER_RATE_HZ * 1e9 / elapsed_ns);
+    }
+
+    free(samples);
+    buzzer_pattern_destroy(pattern);
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "host_test.h"
+#include "buzzer_music.h"
+#include "buzzer_patterns.h"
+#include "buzzer_render.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Renders the shipped tunes and a few runtime patterns and checks what comes out against their keyframes:
+// every keyframe starts at the sample its predecessors' durations add up to, rests are silent from their first
+// sample to their last, and a note's rising zero crossings are its period apart to within a sample. Across a
+// change of note the phase carries on, so the first crossing after a boundary lands where the old note's phase
+// and the new note's period put it, which pins down boundaries between notes as well as around rests.
+#define SILENCE (-128 * 256)
+#define MAX_SAMPLES (4 * 1024 * 1024)
+
+typedef struct {
+    const char* name;
+    const buzzer_pattern_t* pattern;
+    int passes;
+} render_case_t;
+
+static int16_t samples[MAX_SAMPLES];
+static size_t crossings[MAX_SAMPLES / 8];
+
+static uint32_t frame_samples(const buzzer_keyframe_t* keyframe) {
+    return keyframe->duration > 0 ? keyframe->duration * (BUZZER_RENDER_RATE_HZ / 1000) : 1;
+}
+
+static size_t find_crossings(size_t count) {
+    size_t found = 0;
+    for(size_t i = 1; i < count; i++) {
+        if(samples[i - 1] < 0 && samples[i] >= 0 && samples[i - 1] != SILENCE) {
+            crossings[found++] = i;
+        }
+    }
+
+    return found;
+}
+
+// Index of the first crossing at or after sample.
+static size_t crossing_after(size_t crossing_count, size_t sample) {
+    size_t lo = 0, hi = crossing_count;
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(crossings[mid] < sample) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static void check_render(const render_case_t* render) {
+    const buzzer_pattern_t* pattern = render->pattern;
+    size_t count;
+    CHECK_EQ(buzzer_render_pattern(pattern, render->passes, samples, MAX_SAMPLES, &count), ESP_OK);
+    CHECK_EQ(count, buzzer_render_sample_count(pattern, render->passes));
+    size_t crossing_count = find_crossings(count);
+
+    size_t start = 0;
+    int failures = 0;
+    const buzzer_keyframe_t* previous = NULL;
+    for(int pass = 0; pass < render->passes; pass++) {
+        for(int k = 0; k < pattern->frame_count; k++) {
+            const buzzer_keyframe_t* keyframe = &pattern->key_frames[k];
+            size_t end = start + frame_samples(keyframe);
+            CHECK(end <= count);
+
+            int silent = 0;
+            for(size_t i = start; i < end; i++) {
+                silent += samples[i] == SILENCE;
+            }
+            if(keyframe->frequency == 0) {
+                // No wave table reaches -128, so silence is exactly the idle level and nothing else.
+                CHECK_EQ(silent, (int)(end - start));
+            } else {
+                CHECK_EQ(silent, 0);
+            }
+
+            double period = keyframe->frequency > 0 ? (double)BUZZER_RENDER_RATE_HZ / keyframe->frequency : 0;
+            size_t first = crossing_after(crossing_count, start);
+            for(size_t c = first; c + 1 < crossing_count && crossings[c + 1] < end && keyframe->frequency > 0; c++) {
+                double interval = crossings[c + 1] - crossings[c];
+                if(fabs(interval - period) > 1) {
+                    if(failures++ < 5) {
+                        printf("%s keyframe %d (%u Hz): crossings %zu apart at sample %zu, period %.2f\n", render->name, k,
+                               keyframe->frequency, crossings[c + 1] - crossings[c], crossings[c], period);
+                    }
+                    break;
+                }
+            }
+
+            // Note to note: the old note had covered some fraction of a period at the boundary, the new one
+            // finishes the rest at its own rate.
+            if(previous != NULL && previous->frequency > 0 && keyframe->frequency > 0 && first > 0 && first < crossing_count
+                    && crossings[first] < end) {
+                double previous_period = (double)BUZZER_RENDER_RATE_HZ / previous->frequency;
+                double covered = (start - crossings[first - 1]) / previous_period;
+                if(covered <= 1) {
+                    double expected = start + (1 - covered) * period;
+                    if(fabs(crossings[first] - expected) > 2) {
+                        if(failures++ < 5) {
+                            printf("%s keyframe %d: first crossing at %zu, expected %.1f\n", render->name, k, crossings[first], expected);
+                        }
+                    }
+                }
+            }
+
+            previous = keyframe;
+            start = end;
+        }
+    }
+    CHECK_EQ(failures, 0);
+    CHECK_EQ(start, count);
+}
+
+int main() {
+    buzzer_pattern_t* sweep;
+    CHECK_EQ(buzzer_frequency_sweep(200, 4000, 40, 800, &sweep), ESP_OK);
+    sweep->waveform = BUZZER_WAV_SIN;
+    buzzer_pattern_t* looped;
+    CHECK_EQ(parse_music_str("t120o4l8c.d16[e$f]3r4", &looped), ESP_OK);
+    looped->loop = true;
+    buzzer_pattern_t* staccato;
+    CHECK_EQ(parse_music_str("t240o5l16cr16dr16er16fr16gr16", &staccato), ESP_OK);
+
+    const render_case_t renders[] = {
+        { "start", &pattern_start, 1 },
+        { "level_low", &pattern_level_low, 1 },
+        { "level_med", &pattern_level_med, 1 },
+        { "level_high", &pattern_level_high, 2 },
+        { "sweep", sweep, 1 },
+        { "looped", looped, 3 },
+        { "staccato", staccato, 1 },
+    };
+
+    char path[64];
+    for(size_t i = 0; i < sizeof(renders) / sizeof(renders[0]); i++) {
+        const render_case_t* render = &renders[i];
+        check_render(render);
+
+        // The WAVs are left behind to listen to.
+        snprintf(path, sizeof(path), "buzzer_render_%s.wav", render->name);
+        CHECK_EQ(buzzer_render_wav(render->pattern, render->passes, path), ESP_OK);
+        FILE* wav = fopen(path, "rb");
+        CHECK(wav != NULL);
+        if(wav != NULL) {
+            fseek(wav, 0, SEEK_END);
+            CHECK_EQ((size_t)ftell(wav), 44 + buzzer_render_sample_count(render->pattern, render->passes) * sizeof(int16_t));
+            fclose(wav);
+        }
+    }
+
+    buzzer_pattern_destroy(sweep);
+    buzzer_pattern_destroy(looped);
+    buzzer_pattern_destroy(staccato);
+
+    return host_test_result();
+}
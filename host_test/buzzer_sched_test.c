@@ -0,0 +1,190 @@
+#include "host_test.h"
+#include "buzzer_sched.h"
+#include "buzzer_pattern_pool.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// The lane scheduler the GPTimer ISR, the LEDC frame timer and the linux mock all step through, and
+// buzzer_pattern_destroy() refusing patterns the mock still holds.
+
+static const buzzer_keyframe_t notify_frames[] = { { 100, 50 }, { 200, 50 }, { 300, 50 }, { 400, 50 } };
+static const buzzer_keyframe_t alarm_frames[] = { { 1000, 50 }, { 1100, 50 } };
+static const buzzer_keyframe_t second_alarm_frames[] = { { 2000, 50 }, { 2100, 50 } };
+static const buzzer_keyframe_t siren_frames[] = { { 3000, 50 }, { 3100, 50 }, { 3200, 50 } };
+
+static const buzzer_pattern_t notify = { .frame_count = 4, .key_frames = notify_frames };
+static const buzzer_pattern_t alarm = { .frame_count = 2, .key_frames = alarm_frames };
+static const buzzer_pattern_t second_alarm = { .frame_count = 2, .key_frames = second_alarm_frames };
+static const buzzer_pattern_t siren = { .loop = true, .frame_count = 3, .key_frames = siren_frames };
+
+static int sounding(const buzzer_sched_t* sched) {
+    const buzzer_keyframe_t* keyframe = buzzer_sched_keyframe(sched);
+    return keyframe != NULL ? keyframe->frequency : 0;
+}
+
+static int next(buzzer_sched_t* sched) {
+    const buzzer_keyframe_t* keyframe = buzzer_sched_next(sched);
+    CHECK(keyframe == buzzer_sched_keyframe(sched));
+    return keyframe != NULL ? keyframe->frequency : 0;
+}
+
+static void test_preempt_finish_resume() {
+    buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
+    bool changed;
+
+    CHECK(buzzer_sched_play(&sched, &notify, BUZZER_PRIORITY_NOTIFY));
+    CHECK_EQ(sounding(&sched), 100);
+    CHECK_EQ(next(&sched), 200);
+
+    // An alarm cuts the notification off in its second keyframe, a second alarm queues behind the first.
+    CHECK(buzzer_sched_play(&sched, &alarm, BUZZER_PRIORITY_ALARM));
+    CHECK_EQ(sounding(&sched), 1000);
+    CHECK_EQ(buzzer_sched_queue(&sched, &second_alarm, BUZZER_PRIORITY_ALARM, &changed), ESP_OK);
+    CHECK(!changed);
+    // Queueing below the alarm changes nothing that is sounding.
+    CHECK_EQ(buzzer_sched_queue(&sched, &notify, BUZZER_PRIORITY_NOTIFY, &changed), ESP_OK);
+    CHECK(!changed);
+    CHECK_EQ(sounding(&sched), 1000);
+
+    CHECK_EQ(next(&sched), 1100);
+    CHECK_EQ(next(&sched), 2000);
+    CHECK_EQ(next(&sched), 2100);
+
+    // Both alarms done, the notification carries on from the keyframe it was cut off at, then the queued one
+    // plays from the start.
+    CHECK_EQ(next(&sched), 200);
+    CHECK(sched.pattern == &notify);
+    CHECK_EQ(next(&sched), 300);
+    CHECK_EQ(next(&sched), 400);
+    CHECK_EQ(next(&sched), 100);
+    CHECK_EQ(next(&sched), 200);
+    CHECK_EQ(next(&sched), 300);
+    CHECK_EQ(next(&sched), 400);
+    CHECK_EQ(next(&sched), 0);
+    CHECK(sched.pattern == NULL);
+    CHECK_EQ(sched.active_lane, -1);
+    CHECK_EQ(next(&sched), 0);
+}
+
+static void test_replace_and_clear() {
+    buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
+
+    CHECK(buzzer_sched_play(&sched, &siren, BUZZER_PRIORITY_NOTIFY));
+    CHECK_EQ(next(&sched), 3100);
+    CHECK_EQ(next(&sched), 3200);
+    // A looping pattern wraps rather than ending.
+    CHECK_EQ(next(&sched), 3000);
+    CHECK_EQ(next(&sched), 3100);
+
+    CHECK(buzzer_sched_play(&sched, &alarm, BUZZER_PRIORITY_ALARM));
+    CHECK_EQ(next(&sched), 1100);
+    // Replacing the sounding lane's head restarts it on the new pattern.
+    CHECK(buzzer_sched_play(&sched, &second_alarm, BUZZER_PRIORITY_ALARM));
+    CHECK_EQ(sounding(&sched), 2000);
+    // Clearing the alarm lane resumes the siren where it was cut off.
+    CHECK(buzzer_sched_play(&sched, NULL, BUZZER_PRIORITY_ALARM));
+    CHECK_EQ(sounding(&sched), 3100);
+    // Clearing an empty lane below nothing changes nothing.
+    CHECK(!buzzer_sched_play(&sched, NULL, BUZZER_PRIORITY_ALARM));
+
+    CHECK(buzzer_sched_clear(&sched));
+    CHECK_EQ(sounding(&sched), 0);
+    CHECK(!buzzer_sched_clear(&sched));
+}
+
+static void test_queue_limits() {
+    buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
+    bool changed;
+
+    CHECK_EQ(buzzer_sched_queue(&sched, &alarm, BUZZER_PRIORITY_ALARM, &changed), ESP_OK);
+    CHECK(changed);
+    for(int i = 1; i < BUZZER_SCHED_QUEUE_DEPTH; i++) {
+        CHECK_EQ(buzzer_sched_queue(&sched, &second_alarm, BUZZER_PRIORITY_ALARM, &changed), ESP_OK);
+    }
+    CHECK_EQ(buzzer_sched_queue(&sched, &notify, BUZZER_PRIORITY_ALARM, &changed), ESP_ERR_NO_MEM);
+    CHECK(!changed);
+    CHECK(!buzzer_sched_holds(&sched, &notify));
+
+    CHECK_EQ(buzzer_sched_check(NULL, BUZZER_PRIORITY_COUNT), ESP_ERR_INVALID_ARG);
+    buzzer_pattern_t empty = { .frame_count = 0, .key_frames = notify_frames };
+    CHECK_EQ(buzzer_sched_check(&empty, BUZZER_PRIORITY_ALARM), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(buzzer_sched_check(NULL, BUZZER_PRIORITY_ALARM), ESP_OK);
+}
+
+static void test_holds() {
+    buzzer_sched_t sched = BUZZER_SCHED_INITIALIZER;
+    bool changed;
+
+    buzzer_sched_play(&sched, &notify, BUZZER_PRIORITY_NOTIFY);
+    buzzer_sched_play(&sched, &alarm, BUZZER_PRIORITY_ALARM);
+    buzzer_sched_queue(&sched, &second_alarm, BUZZER_PRIORITY_ALARM, &changed);
+    // Sounding, queued and parked.
+    CHECK(buzzer_sched_holds(&sched, &alarm));
+    CHECK(buzzer_sched_holds(&sched, &second_alarm));
+    CHECK(buzzer_sched_holds(&sched, &notify));
+    CHECK(!buzzer_sched_holds(&sched, &siren));
+
+    next(&sched);
+    next(&sched);
+    CHECK(!buzzer_sched_holds(&sched, &alarm));
+    CHECK(buzzer_sched_holds(&sched, &second_alarm));
+}
+
+static buzzer_pattern_t* pool_pattern(int frame_count, uint16_t duration_ms) {
+    buzzer_pattern_t* pattern = NULL;
+    buzzer_keyframe_t* frames = NULL;
+    CHECK_EQ(buzzer_pattern_create(frame_count, &pattern, &frames), ESP_OK);
+    for(int i = 0; i < frame_count; i++) {
+        frames[i] = (buzzer_keyframe_t){ 440, duration_ms };
+    }
+
+    return pattern;
+}
+
+// Through the linux mock, which keeps a pattern until its keyframes have had their time.
+static void test_destroy_refuses_held_patterns() {
+    buzzer_pattern_t* parked = pool_pattern(3, 60000);
+    buzzer_pattern_t* playing = pool_pattern(3, 60000);
+    buzzer_pattern_t* chirp = pool_pattern(2, 5);
+
+    CHECK_EQ(buzzer_control_play_pattern(parked, BUZZER_PRIORITY_NOTIFY), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(buzzer_control_init(), ESP_OK);
+    CHECK_EQ(buzzer_control_play_pattern(parked, BUZZER_PRIORITY_NOTIFY), ESP_OK);
+    CHECK_EQ(buzzer_control_play_pattern(playing, BUZZER_PRIORITY_ALARM), ESP_OK);
+    CHECK_EQ(buzzer_control_queue_pattern(chirp, BUZZER_PRIORITY_ALARM), ESP_OK);
+
+    CHECK_EQ(buzzer_pattern_destroy(parked), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(buzzer_pattern_destroy(playing), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(buzzer_pattern_destroy(chirp), ESP_ERR_INVALID_STATE);
+
+    // Stopping the alarm lane frees both alarms but not the notification it resumes.
+    CHECK_EQ(buzzer_control_play_pattern(NULL, BUZZER_PRIORITY_ALARM), ESP_OK);
+    CHECK_EQ(buzzer_pattern_destroy(playing), ESP_OK);
+    CHECK_EQ(buzzer_pattern_destroy(chirp), ESP_OK);
+    CHECK_EQ(buzzer_pattern_destroy(parked), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(buzzer_control_play_pattern(NULL, BUZZER_PRIORITY_NOTIFY), ESP_OK);
+    CHECK_EQ(buzzer_pattern_destroy(parked), ESP_OK);
+
+    // A one-shot pattern is released once it has played out.
+    chirp = pool_pattern(2, 5);
+    CHECK_EQ(buzzer_control_play_pattern(chirp, BUZZER_PRIORITY_ALARM), ESP_OK);
+    CHECK_EQ(buzzer_pattern_destroy(chirp), ESP_ERR_INVALID_STATE);
+    vTaskDelay(pdMS_TO_TICKS(30));
+    CHECK_EQ(buzzer_pattern_destroy(chirp), ESP_OK);
+
+    size_t patterns_used;
+    size_t frames_used;
+    buzzer_pattern_pool_stats(&patterns_used, &frames_used);
+    CHECK_EQ(patterns_used, 0);
+    CHECK_EQ(frames_used, 0);
+}
+
+int main() {
+    test_preempt_finish_resume();
+    test_replace_and_clear();
+    test_queue_limits();
+    test_holds();
+    test_destroy_refuses_held_patterns();
+
+    return host_test_result();
+}
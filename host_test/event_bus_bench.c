@@ -0,0 +1,163 @@
+#include "host_test.h"
+#include "event_bus.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Throughput and delivery latency of the event bus on the pthread FreeRTOS shim, with its checks:
+//   1. one thread publishing to four subscribers and draining them, the cost per delivered event,
+//   2. a subscriber that stops reading drops only its own events,
+//   3. two producer threads into one subscriber, every event arrives once and in each producer's order,
+//   4. three consumers blocked in event_bus_wait() woken by a publisher 200 us apart, the wake latency.
+#define SUBSCRIBERS 4
+#define LATENCY_EVENTS 20000
+
+static event_bus_subscriber_t* subscribers[SUBSCRIBERS];
+static uint32_t latencies_us[3][LATENCY_EVENTS];
+static long producer_events;
+
+static void* producer(void* args) {
+    int id = (int)(long)args;
+    for(uint32_t k = 0; k < producer_events; k++) {
+        event_bus_event_t event = { .type = EVENT_BUS_LEVEL, .level = { .level = id } };
+        memcpy(event.level.probe_levels, &k, sizeof(k));
+        // A subscriber that was full fails the whole publish, retrying repeats it to the ones that were not.
+        while(event_bus_publish(&event) != ESP_OK) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void* consumer(void* args) {
+    int id = (int)(long)args;
+    event_bus_event_t event;
+    for(int n = 0; n < LATENCY_EVENTS;) {
+        if(event_bus_wait(subscribers[id], &event, portMAX_DELAY)) {
+            latencies_us[id][n++] = event_bus_now_us() - event.timestamp_us;
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void drain(int first) {
+    event_bus_event_t event;
+    for(int i = first; i < SUBSCRIBERS; i++) {
+        while(event_bus_receive(subscribers[i], &event)) {
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    long rounds = host_bench_iterations(argc, argv, 2000000);
+    producer_events = rounds;
+
+    for(int i = 0; i < SUBSCRIBERS; i++) {
+        CHECK_EQ(event_bus_subscribe(EVENT_BUS_MASK(EVENT_BUS_LEVEL), &subscribers[i]), ESP_OK);
+    }
+    event_bus_subscriber_t* extra;
+    CHECK_EQ(event_bus_subscribe(EVENT_BUS_MASK(EVENT_BUS_LEVEL), &extra), ESP_ERR_NO_MEM);
+
+    event_bus_event_t event = { .type = EVENT_BUS_LEVEL };
+    event_bus_event_t received;
+    int64_t start_ns = host_time_ns();
+    for(long k = 0; k < rounds; k++) {
+        event.level.level = k & 3;
+        event_bus_publish(&event);
+        for(int i = 0; i < SUBSCRIBERS; i++) {
+            if(!event_bus_receive(subscribers[i], &received) || received.level.level != (k & 3)) {
+                printf("event %ld lost\n", k);
+                return 1;
+            }
+        }
+    }
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+    printf("event_bus: %.1f M publishes/s to %d subscribers, %.1f ns per delivered event\n",
+           rounds * 1e3 / elapsed_ns, SUBSCRIBERS, (double)elapsed_ns / rounds / SUBSCRIBERS);
+
+    int published = CONFIG_EVENT_BUS_QUEUE_DEPTH + 4;
+    for(int k = 0; k < published; k++) {
+        event_bus_publish(&event);
+        drain(1);
+    }
+    int kept = 0;
+    while(event_bus_receive(subscribers[0], &received)) {
+        kept++;
+    }
+    printf("overflow: kept %d of %d, dropped %" PRIu32 "\n", kept, published, event_bus_dropped(subscribers[0]));
+    CHECK_EQ(kept, CONFIG_EVENT_BUS_QUEUE_DEPTH);
+    CHECK_EQ(event_bus_dropped(subscribers[0]), published - CONFIG_EVENT_BUS_QUEUE_DEPTH);
+    for(int i = 1; i < SUBSCRIBERS; i++) {
+        CHECK_EQ(event_bus_dropped(subscribers[i]), 0);
+    }
+
+    pthread_t producers[2];
+    uint32_t next[2] = { 0, 0 };
+    long total = 0, out_of_order = 0, repeated = 0;
+    start_ns = host_time_ns();
+    for(int i = 0; i < 2; i++) {
+        pthread_create(&producers[i], NULL, producer, (void*)(long)i);
+    }
+    while(total < 2 * producer_events) {
+        if(!event_bus_receive(subscribers[0], &received)) {
+            drain(1);
+            sched_yield();
+            continue;
+        }
+
+        uint32_t k;
+        memcpy(&k, received.level.probe_levels, sizeof(k));
+        uint32_t* expected = &next[received.level.level];
+        if(k + 1 == *expected) {
+            repeated++;
+            continue;
+        }
+        if(k != *expected) {
+            out_of_order++;
+        }
+        *expected = k + 1;
+        total++;
+    }
+    elapsed_ns = host_time_ns() - start_ns;
+    for(int i = 0; i < 2; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    drain(0);
+    printf("2 producers: %ld events, %ld gaps or reorders, %ld retried repeats, %.1f M events/s\n", total,
+           out_of_order, repeated, total * 1e3 / elapsed_ns);
+    CHECK_EQ(out_of_order, 0);
+
+    pthread_t consumers[3];
+    for(int i = 0; i < 3; i++) {
+        pthread_create(&consumers[i], NULL, consumer, (void*)(long)i);
+    }
+    uint32_t dropped_before = event_bus_dropped(subscribers[0]);
+    struct timespec gap = { 0, 200000 };
+    for(int k = 0; k < LATENCY_EVENTS; k++) {
+        event_bus_publish(&event);
+        drain(3);
+        nanosleep(&gap, NULL);
+    }
+    for(int i = 0; i < 3; i++) {
+        pthread_join(consumers[i], NULL);
+        qsort(latencies_us[i], LATENCY_EVENTS, sizeof(uint32_t), compare_u32);
+        printf("consumer %d wake latency: p50 %" PRIu32 " us, p99 %" PRIu32 " us, max %" PRIu32 " us\n", i,
+               latencies_us[i][LATENCY_EVENTS / 2], latencies_us[i][LATENCY_EVENTS * 99 / 100],
+               latencies_us[i][LATENCY_EVENTS - 1]);
+    }
+    CHECK_EQ(event_bus_dropped(subscribers[0]) - dropped_before, 0);
+
+    return host_test_result();
+}
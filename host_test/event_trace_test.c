@@ -0,0 +1,88 @@
+#include "host_test.h"
+#include "event_trace.h"
+#include "sdkconfig.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define RING_RECORDS CONFIG_EVENT_TRACE_RECORDS
+#define WRITERS 3
+
+// arg32 is derived from arg16 and the writer, so a record mixing two writes shows up as a mismatch.
+static uint32_t arg32_for(uint16_t writer, uint16_t arg16) {
+    return ((uint32_t)writer << 24) ^ ((uint32_t)arg16 * 2654435761u);
+}
+
+static void test_snapshot_order() {
+    for(uint32_t i = 0; i < RING_RECORDS + 10; i++) {
+        event_trace_record(TRACE_HYDRO_READ, i & 0xffff, arg32_for(0, i & 0xffff));
+    }
+
+    static event_trace_record_t records[RING_RECORDS];
+    size_t count = event_trace_snapshot(records, RING_RECORDS);
+    CHECK_EQ(count, RING_RECORDS);
+    for(size_t i = 0; i < count; i++) {
+        CHECK_EQ(records[i].arg16, i + 10);
+        CHECK_EQ(records[i].arg32, arg32_for(0, i + 10));
+        if(i > 0) {
+            CHECK_EQ(records[i].seq, records[i - 1].seq + 1);
+        }
+    }
+
+    // A short snapshot keeps the newest records.
+    count = event_trace_snapshot(records, 4);
+    CHECK_EQ(count, 4);
+    CHECK_EQ(records[3].arg16, RING_RECORDS + 9);
+}
+
+static atomic_int writers_running;
+
+static void* writer_main(void* args) {
+    uint16_t writer = (uint16_t)(uintptr_t)args;
+    for(uint32_t i = 0; i < 2000000; i++) {
+        uint16_t arg16 = (uint16_t)i;
+        event_trace_record(TRACE_HYDRO_READ + writer, arg16, arg32_for(writer, arg16));
+    }
+    atomic_fetch_sub(&writers_running, 1);
+
+    return NULL;
+}
+
+// Writers lap the reader constantly, every record a snapshot returns must still be one whole write.
+static void test_concurrent_snapshots() {
+    pthread_t writers[WRITERS];
+    atomic_store(&writers_running, WRITERS);
+    for(uintptr_t i = 0; i < WRITERS; i++) {
+        pthread_create(&writers[i], NULL, writer_main, (void*)i);
+    }
+
+    static event_trace_record_t records[RING_RECORDS];
+    long snapshots = 0, returned = 0, torn = 0, out_of_order = 0;
+    while(atomic_load(&writers_running) > 0) {
+        size_t count = event_trace_snapshot(records, RING_RECORDS);
+        for(size_t i = 0; i < count; i++) {
+            uint16_t writer = records[i].id - TRACE_HYDRO_READ;
+            if(writer >= WRITERS || records[i].arg32 != arg32_for(writer, records[i].arg16)) {
+                torn++;
+            }
+            if(i > 0 && records[i].seq <= records[i - 1].seq) {
+                out_of_order++;
+            }
+        }
+        snapshots++;
+        returned += count;
+    }
+    for(int i = 0; i < WRITERS; i++) {
+        pthread_join(writers[i], NULL);
+    }
+
+    printf("%ld snapshots returned %ld records, %ld torn, %ld out of order\n", snapshots, returned, torn, out_of_order);
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(out_of_order, 0);
+}
+
+int main() {
+    test_snapshot_order();
+    test_concurrent_snapshots();
+
+    return host_test_result();
+}
@@ -0,0 +1,62 @@
+#include "flash_sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+// NOR semantics: erase sets whole sectors to 0xff, a write can only clear bits.
+static uint8_t* image;
+static esp_partition_t partition;
+static flash_sim_stats_t stats;
+
+void flash_sim_reset(uint32_t size) {
+    free(image);
+    image = malloc(size);
+    memset(image, 0xff, size);
+    partition.size = size;
+    stats = (flash_sim_stats_t){0};
+}
+
+flash_sim_stats_t flash_sim_stats() {
+    return stats;
+}
+
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label) {
+    return image != NULL ? &partition : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    if(offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, image + offset, size);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    if(offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t* bytes = src;
+    for(size_t i = 0; i < size; i++) {
+        if(bytes[i] & ~image[offset + i]) {
+            stats.bad_writes++;
+        }
+        image[offset + i] &= bytes[i];
+    }
+    stats.writes++;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    if(offset % FLASH_SIM_SECTOR_SIZE != 0 || size % FLASH_SIM_SECTOR_SIZE != 0 || offset + size > part->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(image + offset, 0xff, size);
+    stats.erases++;
+
+    return ESP_OK;
+}
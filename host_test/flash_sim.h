@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_partition.h"
+
+#define FLASH_SIM_SECTOR_SIZE 4096
+
+typedef struct {
+    uint32_t writes;
+    uint32_t erases;
+    // Writes that needed a 0 bit back to 1, which NOR flash cannot do without an erase.
+    uint32_t bad_writes;
+} flash_sim_stats_t;
+
+// Replaces the partition with an erased image of size bytes and clears the stats.
+void flash_sim_reset(uint32_t size);
+
+flash_sim_stats_t flash_sim_stats();
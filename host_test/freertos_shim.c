@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+#include "esp_err.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Every object is a mutex and a condition variable on CLOCK_MONOTONIC, timeouts are absolute deadlines.
+
+struct shim_task {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t value;
+    bool pending;
+    TaskFunction_t function;
+    void* args;
+};
+
+struct shim_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t* items;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+};
+
+struct shim_stream {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t* data;
+    size_t size;
+    size_t trigger_level;
+    size_t head;
+    size_t count;
+};
+
+static pthread_mutex_t critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct shim_task* current_task;
+
+static void init_sync(pthread_mutex_t* lock, pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(lock, NULL);
+}
+
+static int64_t now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static struct timespec deadline_for(TickType_t ticks) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    return deadline;
+}
+
+// Waits on cond until *flag is set or the ticks run out. The lock must be held.
+static bool wait_for(pthread_cond_t* cond, pthread_mutex_t* lock, const bool* flag, TickType_t ticks) {
+    struct timespec deadline = deadline_for(ticks == portMAX_DELAY ? 0 : ticks);
+    while(!*flag) {
+        if(ticks == portMAX_DELAY) {
+            pthread_cond_wait(cond, lock);
+        } else if(ticks == 0 || pthread_cond_timedwait(cond, lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    return *flag;
+}
+
+void shim_enter_critical() {
+    pthread_mutex_lock(&critical_lock);
+}
+
+void shim_exit_critical() {
+    pthread_mutex_unlock(&critical_lock);
+}
+
+static struct shim_task* task_new(TaskFunction_t function, void* args) {
+    struct shim_task* task = calloc(1, sizeof(struct shim_task));
+    init_sync(&task->lock, &task->cond);
+    task->function = function;
+    task->args = args;
+
+    return task;
+}
+
+static void* task_main(void* args) {
+    current_task = args;
+    current_task->function(current_task->args);
+
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* args, UBaseType_t priority,
+                       TaskHandle_t* handle_out) {
+    struct shim_task* task = task_new(function, args);
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, task_main, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+
+    if(handle_out != NULL) {
+        *handle_out = task;
+    }
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if(task != NULL && task != current_task) {
+        fprintf(stderr, "vTaskDelete: only a task deleting itself is supported\n");
+        abort();
+    }
+
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec delay = {
+        .tv_sec = ticks / 1000,
+        .tv_nsec = (long)(ticks % 1000) * 1000000,
+    };
+    nanosleep(&delay, NULL);
+}
+
+TickType_t xTaskGetTickCount() {
+    static int64_t start_ms;
+    if(start_ms == 0) {
+        start_ms = now_ms();
+    }
+
+    return (TickType_t)(now_ms() - start_ms);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    // Threads the shim did not start, such as main, get a task on first use.
+    if(current_task == NULL) {
+        current_task = task_new(NULL, NULL);
+    }
+
+    return current_task;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    pthread_mutex_lock(&task->lock);
+    switch(action) {
+    case eSetBits:
+        task->value |= value;
+        break;
+    case eIncrement:
+        task->value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->value = value;
+        break;
+    case eNoAction:
+        break;
+    }
+    task->pending = true;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken) {
+    if(woken != NULL) {
+        *woken = pdFALSE;
+    }
+
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value_out, TickType_t ticks) {
+    struct shim_task* task = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&task->lock);
+    if(!task->pending) {
+        task->value &= ~clear_on_entry;
+    }
+    bool notified = wait_for(&task->cond, &task->lock, &task->pending, ticks);
+    if(value_out != NULL) {
+        *value_out = task->value;
+    }
+    if(notified) {
+        task->value &= ~clear_on_exit;
+        task->pending = false;
+    }
+    pthread_mutex_unlock(&task->lock);
+
+    return notified ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct shim_task* task = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&task->lock);
+    task->pending = task->value != 0;
+    wait_for(&task->cond, &task->lock, &task->pending, ticks);
+    uint32_t value = task->value;
+    if(value != 0) {
+        task->value = clear_on_exit ? 0 : value - 1;
+    }
+    task->pending = false;
+    pthread_mutex_unlock(&task->lock);
+
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct shim_queue* queue = calloc(1, sizeof(struct shim_queue));
+    init_sync(&queue->lock, &queue->cond);
+    queue->items = malloc((size_t)length * item_size);
+    queue->item_size = item_size;
+    queue->length = length;
+
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    pthread_mutex_lock(&queue->lock);
+    bool has_space = queue->count < queue->length;
+    while(!has_space && ticks != 0) {
+        // Senders here never block, a full queue with a timeout only waits once.
+        bool changed = false;
+        wait_for(&queue->cond, &queue->lock, &changed, ticks);
+        has_space = queue->count < queue->length;
+        ticks = 0;
+    }
+    if(has_space) {
+        if(queue->item_size > 0) {
+            memcpy(&queue->items[(queue->head + queue->count) % queue->length * queue->item_size], item, queue->item_size);
+        }
+        queue->count++;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return has_space ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    if(woken != NULL) {
+        *woken = pdFALSE;
+    }
+
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    pthread_mutex_lock(&queue->lock);
+    bool available = queue->count > 0;
+    struct timespec deadline = deadline_for(ticks == portMAX_DELAY ? 0 : ticks);
+    while(!available && ticks != 0) {
+        if(ticks == portMAX_DELAY) {
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        } else if(pthread_cond_timedwait(&queue->cond, &queue->lock, &deadline) == ETIMEDOUT) {
+            available = queue->count > 0;
+            break;
+        }
+        available = queue->count > 0;
+    }
+    if(available) {
+        if(queue->item_size > 0) {
+            memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return available ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+
+    return count;
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level) {
+    struct shim_stream* stream = calloc(1, sizeof(struct shim_stream));
+    init_sync(&stream->lock, &stream->cond);
+    stream->data = malloc(size);
+    stream->size = size;
+    stream->trigger_level = trigger_level > 0 ? trigger_level : 1;
+
+    return stream;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t stream) {
+    free(stream->data);
+    free(stream);
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void* data, size_t length, TickType_t ticks) {
+    pthread_mutex_lock(&stream->lock);
+    size_t space = stream->size - stream->count;
+    if(length > space) {
+        length = space;
+    }
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < length; i++) {
+        stream->data[(stream->head + stream->count + i) % stream->size] = bytes[i];
+    }
+    stream->count += length;
+    if(stream->count >= stream->trigger_level) {
+        pthread_cond_broadcast(&stream->cond);
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return length;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void* data, size_t length, TickType_t ticks) {
+    pthread_mutex_lock(&stream->lock);
+    if(stream->count == 0 && ticks != 0) {
+        struct timespec deadline = deadline_for(ticks == portMAX_DELAY ? 0 : ticks);
+        while(stream->count < stream->trigger_level) {
+            if(ticks == portMAX_DELAY) {
+                pthread_cond_wait(&stream->cond, &stream->lock);
+            } else if(pthread_cond_timedwait(&stream->cond, &stream->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+
+    if(length > stream->count) {
+        length = stream->count;
+    }
+    uint8_t* bytes = data;
+    for(size_t i = 0; i < length; i++) {
+        bytes[i] = stream->data[(stream->head + i) % stream->size];
+    }
+    stream->head = (stream->head + length) % stream->size;
+    stream->count -= length;
+    pthread_mutex_unlock(&stream->lock);
+
+    return length;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->head = 0;
+    stream->count = 0;
+    pthread_mutex_unlock(&stream->lock);
+
+    return pdPASS;
+}
+
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t stream) {
+    pthread_mutex_lock(&stream->lock);
+    bool empty = stream->count == 0;
+    pthread_mutex_unlock(&stream->lock);
+
+    return empty ? pdTRUE : pdFALSE;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t stream) {
+    pthread_mutex_lock(&stream->lock);
+    size_t space = stream->size - stream->count;
+    pthread_mutex_unlock(&stream->lock);
+
+    return space;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch(code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void shim_error_check_failed(esp_err_t code, const char* file, int line, const char* expression, bool abort_on_error) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n", code,
+            esp_err_to_name(code), file, line, expression);
+    if(abort_on_error) {
+        abort();
+    }
+}
+
+void esp_restart() {
+    exit(0);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <inttypes.h>
+
+// Reports the failing expression and keeps going, host_test_result() turns any failure into the exit code.
+static int host_test_failures;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        host_test_failures++; \
+    } \
+} while(0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if(_a != _b) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed, %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        host_test_failures++; \
+    } \
+} while(0)
+
+static inline int host_test_result() {
+    if(host_test_failures > 0) {
+        fprintf(stderr, "%d checks failed\n", host_test_failures);
+        return 1;
+    }
+
+    return 0;
+}
+
+static inline int64_t host_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Benchmarks take their iteration count as the first argument, so ctest runs stay short.
+static inline long host_bench_iterations(int argc, char** argv, long fallback) {
+    return argc > 1 ? atol(argv[1]) : fallback;
+}
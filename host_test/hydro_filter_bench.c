@@ -0,0 +1,47 @@
+#include "host_test.h"
+#include "hydro_filter.h"
+
+// Cost per sample of the stream filter on noise straddling the LOW boundary, and how often the level
+// changes compared with classifying each raw sample.
+int main(int argc, char** argv) {
+    long count = host_bench_iterations(argc, argv, 2000000);
+    uint16_t* trace = malloc(count * sizeof(uint16_t));
+    if(trace == NULL) {
+        return 1;
+    }
+
+    srand(1);
+    long raw_changes = 0;
+    hydro_level_t raw_last = HYDRO_LEVEL_ERR;
+    for(long i = 0; i < count; i++) {
+        trace[i] = HYDRO_LOW_LEVEL_THRESHOLD + rand() % 81 - 40;
+        hydro_level_t level = hydro_level_for_mv(trace[i]);
+        if(level != raw_last) {
+            raw_changes++;
+            raw_last = level;
+        }
+    }
+
+    static const hydro_filter_config_t config = HYDRO_FILTER_STREAM_CONFIG();
+    hydro_filter_t filter;
+    hydro_filter_init(&filter, &config);
+
+    long changes = 0;
+    hydro_level_t last = HYDRO_LEVEL_ERR;
+    int64_t start_ns = host_time_ns();
+    for(long i = 0; i < count; i++) {
+        hydro_level_t level = hydro_filter_push(&filter, trace[i]);
+        if(level != last) {
+            changes++;
+            last = level;
+        }
+    }
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+
+    printf("hydro_filter stream config: %.1f ns/sample, %.1f Msamples/s\n",
+           (double)elapsed_ns / count, count * 1e3 / elapsed_ns);
+    printf("level changes over %ld samples: %ld filtered, %ld raw\n", count, changes, raw_changes);
+    free(trace);
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "host_test.h"
+#include "hydro_filter.h"
+
+static const hydro_filter_config_t poll_config = HYDRO_FILTER_POLL_CONFIG();
+static const hydro_filter_config_t stream_config = HYDRO_FILTER_STREAM_CONFIG();
+
+static void test_level_for_mv() {
+    CHECK_EQ(hydro_level_for_mv(3000), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_level_for_mv(HYDRO_LOW_LEVEL_THRESHOLD + 1), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_level_for_mv(HYDRO_LOW_LEVEL_THRESHOLD), HYDRO_LEVEL_LOW);
+    CHECK_EQ(hydro_level_for_mv(HYDRO_MED_LEVEL_THRESHOLD), HYDRO_LEVEL_MED);
+    CHECK_EQ(hydro_level_for_mv(0), HYDRO_LEVEL_HIGH);
+
+    int32_t low_mv, high_mv;
+    CHECK_EQ(hydro_level_band(&poll_config, HYDRO_LEVEL_OK, &low_mv, &high_mv), ESP_OK);
+    CHECK_EQ(low_mv, HYDRO_LOW_LEVEL_THRESHOLD + 1);
+    CHECK_EQ(high_mv, -1);
+    CHECK_EQ(hydro_level_band(&poll_config, HYDRO_LEVEL_HIGH, &low_mv, &high_mv), ESP_OK);
+    CHECK_EQ(low_mv, -1);
+    CHECK_EQ(high_mv, HYDRO_HIGH_LEVEL_THRESHOLD + poll_config.hysteresis[HYDRO_LEVEL_HIGH - 1]);
+    CHECK_EQ(hydro_level_band(&poll_config, HYDRO_LEVEL_ERR, &low_mv, &high_mv), ESP_ERR_INVALID_ARG);
+}
+
+// Same test the stream applies to arm a threshold event.
+static bool outside_band(int32_t mv, int32_t low_mv, int32_t high_mv) {
+    return (low_mv >= 0 && mv < low_mv) || (high_mv >= 0 && mv > high_mv);
+}
+
+// A reading in the hysteresis margin keeps the filter's level, so the band re-armed for that level
+// must not count it as a crossing or event mode would wake on it over and over.
+static void test_band_covers_hysteresis() {
+    hydro_filter_t filter;
+    CHECK_EQ(hydro_filter_init(&filter, &stream_config), ESP_OK);
+
+    for(int i = 0; i < 200; i++) {
+        hydro_filter_push(&filter, HYDRO_MED_LEVEL_THRESHOLD - 100);
+    }
+    CHECK_EQ(hydro_filter_level(&filter), HYDRO_LEVEL_MED);
+
+    for(int32_t mv = HYDRO_MED_LEVEL_THRESHOLD + 1; mv <= HYDRO_MED_LEVEL_THRESHOLD + stream_config.hysteresis[1]; mv++) {
+        for(int i = 0; i < 200; i++) {
+            hydro_filter_push(&filter, mv);
+        }
+        CHECK_EQ(hydro_filter_level(&filter), HYDRO_LEVEL_MED);
+
+        int32_t low_mv, high_mv;
+        CHECK_EQ(hydro_level_band(&stream_config, hydro_filter_level(&filter), &low_mv, &high_mv), ESP_OK);
+        CHECK(!outside_band(mv, low_mv, high_mv));
+    }
+
+    // One past the margin is a real crossing, both for the band and the filter.
+    int32_t mv = HYDRO_MED_LEVEL_THRESHOLD + stream_config.hysteresis[1] + 1;
+    int32_t low_mv, high_mv;
+    CHECK_EQ(hydro_level_band(&stream_config, HYDRO_LEVEL_MED, &low_mv, &high_mv), ESP_OK);
+    CHECK(outside_band(mv, low_mv, high_mv));
+    for(int i = 0; i < 200; i++) {
+        hydro_filter_push(&filter, mv);
+    }
+    CHECK_EQ(hydro_filter_level(&filter), HYDRO_LEVEL_LOW);
+}
+
+static void test_median_rejects_spike() {
+    hydro_filter_t filter;
+    CHECK_EQ(hydro_filter_init(&filter, &poll_config), ESP_OK);
+
+    CHECK_EQ(hydro_filter_push(&filter, 3000), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_filter_push(&filter, 3000), HYDRO_LEVEL_OK);
+    // One sample deep in HIGH is outvoted by its neighbours.
+    CHECK_EQ(hydro_filter_push(&filter, 100), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_filter_push(&filter, 3000), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_filter_value(&filter), 3000);
+}
+
+static void test_hysteresis_and_dwell() {
+    hydro_filter_t filter;
+    hydro_filter_config_t config = HYDRO_FILTER_POLL_CONFIG();
+    config.median_len = 1;
+    config.iir_shift = 0;
+    CHECK_EQ(hydro_filter_init(&filter, &config), ESP_OK);
+
+    CHECK_EQ(hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD + 100), HYDRO_LEVEL_OK);
+    CHECK_EQ(hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD), HYDRO_LEVEL_LOW);
+
+    // Inside the hysteresis margin the level holds.
+    CHECK_EQ(hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD + config.hysteresis[0]), HYDRO_LEVEL_LOW);
+
+    // Back to OK needs dwell_samples[OK] readings past the margin.
+    CHECK_EQ(hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD + config.hysteresis[0] + 1), HYDRO_LEVEL_LOW);
+    CHECK_EQ(hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD + config.hysteresis[0] + 1), HYDRO_LEVEL_OK);
+}
+
+static void test_stream_config_holds_on_noise() {
+    hydro_filter_t filter;
+    CHECK_EQ(hydro_filter_init(&filter, &stream_config), ESP_OK);
+
+    srand(1);
+    int changes = 0;
+    hydro_level_t last = HYDRO_LEVEL_ERR;
+    for(int i = 0; i < 100000; i++) {
+        hydro_level_t level = hydro_filter_push(&filter, HYDRO_LOW_LEVEL_THRESHOLD + rand() % 81 - 40);
+        if(level != last) {
+            changes++;
+            last = level;
+        }
+    }
+
+    // The first reading sets the level, +-40 mV around a boundary may then settle once.
+    CHECK(changes <= 2);
+}
+
+static void test_rejects_bad_config() {
+    hydro_filter_t filter;
+    hydro_filter_config_t config = HYDRO_FILTER_POLL_CONFIG();
+    config.median_len = HYDRO_FILTER_MEDIAN_MAX + 1;
+    CHECK_EQ(hydro_filter_init(&filter, &config), ESP_ERR_INVALID_ARG);
+    config.median_len = 0;
+    CHECK_EQ(hydro_filter_init(&filter, &config), ESP_ERR_INVALID_ARG);
+}
+
+int main() {
+    test_level_for_mv();
+    test_median_rejects_spike();
+    test_hysteresis_and_dwell();
+    test_band_covers_hysteresis();
+    test_stream_config_holds_on_noise();
+    test_rejects_bad_config();
+
+    return host_test_result();
+}
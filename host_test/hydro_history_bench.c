@@ -0,0 +1,58 @@
+#include "host_test.h"
+#include "flash_sim.h"
+#include "hydro_history.h"
+
+// A 1 MB partition like partitions.csv, filled at 1 Hz with +-1 mV noise on a slow drift and a 3 s gap every
+// 1000 s. Reports density, append cost and the cost of a 60 s range query.
+#define PARTITION_SIZE (1024 * 1024)
+
+static uint32_t timestamp_at(long i) {
+    return 1700000000u + i + (i / 1000) * 3;
+}
+
+int main(int argc, char** argv) {
+    long count = host_bench_iterations(argc, argv, 600000);
+
+    flash_sim_reset(PARTITION_SIZE);
+    hydro_history_init("history");
+
+    srand(1);
+    int64_t start_ns = host_time_ns();
+    for(long i = 0; i < count; i++) {
+        uint16_t value = 2500 + (i / 600) % 50 + rand() % 3 - 1;
+        if(hydro_history_append(timestamp_at(i), value) != ESP_OK) {
+            printf("append %ld failed\n", i);
+            return 1;
+        }
+    }
+    int64_t append_ns = host_time_ns() - start_ns;
+    hydro_history_flush();
+
+    static hydro_history_point_t points[PARTITION_SIZE];
+    size_t stored;
+    hydro_history_query(0, UINT32_MAX, points, PARTITION_SIZE, &stored);
+    uint32_t used, total, appended;
+    hydro_history_stats(&used, &total, &appended);
+    double used_bytes = (double)used * FLASH_SIM_SECTOR_SIZE;
+
+    long first = count - stored;
+    int queries = 1000;
+    size_t found = 0;
+    start_ns = host_time_ns();
+    for(int q = 0; q < queries; q++) {
+        uint32_t from = timestamp_at(first + (long)q * 97 % stored);
+        size_t n;
+        hydro_history_query(from, from + 60, points, PARTITION_SIZE, &n);
+        found += n;
+    }
+    int64_t query_ns = host_time_ns() - start_ns;
+
+    flash_sim_stats_t stats = flash_sim_stats();
+    printf("hydro_history: %.1f bits/point, %.1f days at 1 Hz per MB\n",
+           used_bytes * 8 / stored, stored / (used_bytes / (1024 * 1024)) / 86400);
+    printf("append %.1f ns/point, %" PRIu32 " writes and %" PRIu32 " erases for %ld points\n",
+           (double)append_ns / count, stats.writes, stats.erases, count);
+    printf("60 s range query %.2f us, %.1f points each\n", (double)query_ns / queries / 1000, (double)found / queries);
+
+    return 0;
+}
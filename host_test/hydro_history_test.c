@@ -0,0 +1,142 @@
+#include "host_test.h"
+#include "flash_sim.h"
+#include "hydro_history.h"
+#include <string.h>
+
+#define SECTORS 16
+#define MAX_POINTS 200000
+
+static hydro_history_point_t expected[MAX_POINTS];
+static hydro_history_point_t points[MAX_POINTS];
+
+// Exercises every timestamp and value code: steady 1 s steps, small and large interval changes, long
+// gaps, noise, small and large value steps and full range jumps.
+static hydro_history_point_t point_at(uint32_t i) {
+    static uint32_t timestamp = 1700000000;
+    static uint16_t value = 2500;
+
+    if(i % 997 == 0) {
+        timestamp += 100000;
+    } else if(i % 101 == 0) {
+        timestamp += 1 + i % 300;
+    } else if(i % 13 == 0) {
+        timestamp += 2;
+    } else {
+        timestamp += 1;
+    }
+
+    if(i % 499 == 0) {
+        value = (uint16_t)(i * 2654435761u >> 16);
+    } else if(i % 37 == 0) {
+        value += 50;
+    } else {
+        value += rand() % 3 - 1;
+    }
+
+    return (hydro_history_point_t){ .timestamp = timestamp, .value = value };
+}
+
+// Checks the stored points are exactly the newest count written, in order.
+static void check_tail(uint32_t written) {
+    size_t count;
+    CHECK_EQ(hydro_history_query(0, UINT32_MAX, points, MAX_POINTS, &count), ESP_OK);
+    CHECK(count > 0 && count <= written);
+
+    uint32_t first = written - count;
+    int mismatches = 0;
+    for(size_t i = 0; i < count; i++) {
+        mismatches += points[i].timestamp != expected[first + i].timestamp || points[i].value != expected[first + i].value;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_round_trip_across_remount() {
+    flash_sim_reset(SECTORS * FLASH_SIM_SECTOR_SIZE);
+    CHECK_EQ(hydro_history_init("history"), ESP_OK);
+    CHECK_EQ(hydro_history_latest(), 0);
+
+    srand(1);
+    uint32_t count = 5000;
+    for(uint32_t i = 0; i < count; i++) {
+        expected[i] = point_at(i);
+        CHECK_EQ(hydro_history_append(expected[i].timestamp, expected[i].value), ESP_OK);
+    }
+    check_tail(count);
+
+    // Anything flushed survives a remount, and appends resume after it.
+    CHECK_EQ(hydro_history_flush(), ESP_OK);
+    CHECK_EQ(hydro_history_init("history"), ESP_OK);
+    CHECK_EQ(hydro_history_latest(), expected[count - 1].timestamp);
+    check_tail(count);
+
+    for(uint32_t i = count; i < 2 * count; i++) {
+        expected[i] = point_at(i);
+        CHECK_EQ(hydro_history_append(expected[i].timestamp, expected[i].value), ESP_OK);
+    }
+    check_tail(2 * count);
+
+    CHECK_EQ(hydro_history_append(expected[0].timestamp, 0), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(flash_sim_stats().bad_writes, 0);
+}
+
+static void test_wraps_and_drops_oldest() {
+    flash_sim_reset(SECTORS * FLASH_SIM_SECTOR_SIZE);
+    CHECK_EQ(hydro_history_init("history"), ESP_OK);
+
+    srand(2);
+    uint32_t count = MAX_POINTS;
+    for(uint32_t i = 0; i < count; i++) {
+        expected[i] = point_at(i);
+        CHECK_EQ(hydro_history_append(expected[i].timestamp, expected[i].value), ESP_OK);
+        if(i == count / 2) {
+            CHECK_EQ(hydro_history_flush(), ESP_OK);
+            CHECK_EQ(hydro_history_init("history"), ESP_OK);
+        }
+    }
+
+    uint32_t used, total, appended;
+    hydro_history_stats(&used, &total, &appended);
+    CHECK_EQ(total, SECTORS);
+    CHECK_EQ(used, SECTORS);
+    check_tail(count);
+
+    // Erases rotate through every sector rather than reusing a few.
+    flash_sim_stats_t stats = flash_sim_stats();
+    CHECK(stats.erases > 2 * SECTORS);
+    CHECK_EQ(stats.bad_writes, 0);
+}
+
+static void test_range_query() {
+    // Carries on from the wrapped log, ranges inside it come back exact and complete.
+    size_t all;
+    CHECK_EQ(hydro_history_query(0, UINT32_MAX, points, MAX_POINTS, &all), ESP_OK);
+    uint32_t first = MAX_POINTS - all;
+
+    for(uint32_t start = first; start + 200 < MAX_POINTS; start += 7919) {
+        uint32_t from = expected[start].timestamp;
+        uint32_t to = expected[start + 150].timestamp;
+        size_t count;
+        CHECK_EQ(hydro_history_query(from, to, points, MAX_POINTS, &count), ESP_OK);
+
+        uint32_t want = 0;
+        for(uint32_t i = first; i < MAX_POINTS; i++) {
+            want += expected[i].timestamp >= from && expected[i].timestamp <= to;
+        }
+        CHECK_EQ(count, want);
+        CHECK(count > 0 && points[0].timestamp >= from && points[count - 1].timestamp <= to);
+    }
+
+    // A short buffer gets the oldest points of the range.
+    size_t count;
+    CHECK_EQ(hydro_history_query(0, UINT32_MAX, points, 10, &count), ESP_OK);
+    CHECK_EQ(count, 10);
+    CHECK_EQ(points[0].timestamp, expected[first].timestamp);
+}
+
+int main() {
+    test_round_trip_across_remount();
+    test_wraps_and_drops_oldest();
+    test_range_query();
+
+    return host_test_result();
+}
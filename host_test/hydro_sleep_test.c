@@ -0,0 +1,148 @@
+#include "host_test.h"
+#include "hydro_sleep.h"
+#include <string.h>
+
+#define BURST 8
+#define DRY_MV 3000
+#define WET_MV (HYDRO_MED_LEVEL_THRESHOLD - 100)
+
+static const hydro_filter_config_t filter_config = HYDRO_FILTER_POLL_CONFIG();
+static const hydro_sleep_config_t sleep_config = {
+    .interval_s = 30,
+    .max_interval_s = 240,
+    .report_interval_s = 3600,
+};
+
+static hydro_wake_action_t wake(hydro_sleep_state_t* state, uint16_t mv) {
+    uint16_t samples[BURST];
+    for(int i = 0; i < BURST; i++) {
+        samples[i] = mv;
+    }
+
+    return hydro_sleep_decide(state, samples, BURST);
+}
+
+static void test_cold_boot_and_warm_state() {
+    hydro_sleep_state_t state;
+    memset(&state, 0xA5, sizeof(state));
+    // RTC memory holds garbage after power on.
+    CHECK(!hydro_sleep_state_valid(&state));
+    CHECK_EQ(hydro_sleep_state_init(&state, &sleep_config, &filter_config), ESP_OK);
+    CHECK(hydro_sleep_state_valid(&state));
+    CHECK_EQ(state.interval_s, sleep_config.interval_s);
+
+    // The first wake has nothing reported yet, so even a dry probe is reported.
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.reported_level, HYDRO_LEVEL_OK);
+
+    // Kept state carries the filter over, the next dry wake goes straight back to sleep.
+    hydro_sleep_state_t retained = state;
+    CHECK(hydro_sleep_state_valid(&retained));
+    CHECK_EQ(wake(&retained, DRY_MV), HYDRO_WAKE_SLEEP);
+    CHECK_EQ(retained.wake_count, 2);
+
+    hydro_sleep_config_t bad = sleep_config;
+    bad.max_interval_s = bad.interval_s - 1;
+    CHECK_EQ(hydro_sleep_state_init(&state, &bad, &filter_config), ESP_ERR_INVALID_ARG);
+    bad = sleep_config;
+    bad.interval_s = 0;
+    CHECK_EQ(hydro_sleep_state_init(&state, &bad, &filter_config), ESP_ERR_INVALID_ARG);
+}
+
+static void test_level_change_reports() {
+    hydro_sleep_state_t state;
+    CHECK_EQ(hydro_sleep_state_init(&state, &sleep_config, &filter_config), ESP_OK);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_SLEEP);
+
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.reported_level, HYDRO_LEVEL_MED);
+    // A wet probe repeats the alarm on every wake.
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+
+    // Drying out is reported once, then it sleeps again.
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.reported_level, HYDRO_LEVEL_OK);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_SLEEP);
+}
+
+static void test_backoff_and_reset() {
+    hydro_sleep_state_t state;
+    CHECK_EQ(hydro_sleep_state_init(&state, &sleep_config, &filter_config), ESP_OK);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.interval_s, 30);
+
+    static const uint32_t expected[] = { 60, 120, 240, 240, 240 };
+    for(int i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_SLEEP);
+        CHECK_EQ(state.interval_s, expected[i]);
+    }
+
+    // A leak brings the short interval straight back and keeps it while wet.
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.interval_s, 30);
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.interval_s, 30);
+
+    // After drying out the backoff starts over from the bottom.
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.interval_s, 30);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_SLEEP);
+    CHECK_EQ(state.interval_s, 60);
+
+    // Limits that do not divide evenly still stop at the maximum.
+    hydro_sleep_config_t odd = { .interval_s = 7, .max_interval_s = 50, .report_interval_s = 0 };
+    CHECK_EQ(hydro_sleep_state_init(&state, &odd, &filter_config), ESP_OK);
+    wake(&state, DRY_MV);
+    for(int i = 0; i < 10; i++) {
+        wake(&state, DRY_MV);
+    }
+    CHECK_EQ(state.interval_s, 50);
+}
+
+static void test_periodic_report() {
+    hydro_sleep_state_t state;
+    CHECK_EQ(hydro_sleep_state_init(&state, &sleep_config, &filter_config), ESP_OK);
+    CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_ALARM);
+
+    // Dry for days, the cores run once per report interval of time asleep.
+    uint32_t slept_s = 0;
+    uint32_t last_report_s = 0;
+    int reports = 0;
+    while(slept_s < 3 * 86400) {
+        slept_s += state.interval_s;
+        hydro_wake_action_t action = wake(&state, DRY_MV);
+        CHECK(action != HYDRO_WAKE_ALARM);
+        if(action == HYDRO_WAKE_REPORT) {
+            uint32_t since_s = slept_s - last_report_s;
+            CHECK(since_s >= sleep_config.report_interval_s);
+            CHECK(since_s < sleep_config.report_interval_s + sleep_config.max_interval_s);
+            last_report_s = slept_s;
+            reports++;
+        }
+    }
+    CHECK(reports >= 3 * 86400 / (sleep_config.report_interval_s + sleep_config.max_interval_s));
+    CHECK(reports <= 3 * 86400 / sleep_config.report_interval_s);
+
+    // An alarm counts as a report, the next periodic one is a full interval after it.
+    CHECK_EQ(wake(&state, WET_MV), HYDRO_WAKE_ALARM);
+    CHECK_EQ(state.since_report_s, 0);
+
+    hydro_sleep_config_t never = sleep_config;
+    never.report_interval_s = 0;
+    CHECK_EQ(hydro_sleep_state_init(&state, &never, &filter_config), ESP_OK);
+    wake(&state, DRY_MV);
+    for(int i = 0; i < 10000; i++) {
+        CHECK_EQ(wake(&state, DRY_MV), HYDRO_WAKE_SLEEP);
+    }
+}
+
+int main() {
+    test_cold_boot_and_warm_state();
+    test_level_change_reports();
+    test_backoff_and_reset();
+    test_periodic_report();
+
+    return host_test_result();
+}
@@ -0,0 +1,21 @@
+#include "host_test.h"
+#include "hydro_trend.h"
+
+int main(int argc, char** argv) {
+    long count = host_bench_iterations(argc, argv, 20000000);
+
+    static const hydro_trend_config_t config = HYDRO_TREND_DEFAULT_CONFIG(4000);
+    hydro_trend_t trend;
+    hydro_trend_init(&trend, &config);
+
+    volatile int warnings = 0;
+    int64_t start_ns = host_time_ns();
+    for(long i = 0; i < count; i++) {
+        warnings += hydro_trend_push(&trend, (uint16_t)(2000 + (i & 15)));
+    }
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+
+    printf("hydro_trend window %d: %.2f ns/push\n", config.window, (double)elapsed_ns / count);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "host_test.h"
+#include "hydro_trend.h"
+
+static const hydro_trend_config_t config = {
+    .window = 16,
+    .sample_period_ms = 4000,
+    .warn_mv_per_min = 30,
+    .clear_mv_per_min = 15,
+};
+
+// Reference least squares slope in mV per minute, positive while falling, truncated like the estimator.
+static int32_t reference_rate(const uint16_t* samples, int n, uint32_t period_ms) {
+    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_xx = 0;
+    for(int x = 0; x < n; x++) {
+        sum_x += x;
+        sum_y += samples[x];
+        sum_xy += (double)x * samples[x];
+        sum_xx += (double)x * x;
+    }
+    double slope = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+
+    return (int32_t)(-slope * 60000 / period_ms);
+}
+
+static void test_rejects_bad_config() {
+    hydro_trend_t trend;
+    hydro_trend_config_t bad = config;
+    bad.window = 2;
+    CHECK_EQ(hydro_trend_init(&trend, &bad), ESP_ERR_INVALID_ARG);
+    bad.window = HYDRO_TREND_WINDOW_MAX + 1;
+    CHECK_EQ(hydro_trend_init(&trend, &bad), ESP_ERR_INVALID_ARG);
+    bad = config;
+    bad.clear_mv_per_min = bad.warn_mv_per_min + 1;
+    CHECK_EQ(hydro_trend_init(&trend, &bad), ESP_ERR_INVALID_ARG);
+}
+
+static void test_matches_float_regression() {
+    for(uint8_t window = 3; window <= HYDRO_TREND_WINDOW_MAX; window += 7) {
+        hydro_trend_config_t sized = config;
+        sized.window = window;
+        hydro_trend_t trend;
+        CHECK_EQ(hydro_trend_init(&trend, &sized), ESP_OK);
+
+        static uint16_t history[5000];
+        int mismatches = 0;
+        srand(window);
+        for(int i = 0; i < 5000; i++) {
+            history[i] = 2000 + (i % 700 < 350 ? -(i % 350) : (i % 350) - 350) + rand() % 21 - 10;
+            hydro_trend_push(&trend, history[i]);
+            if(i + 1 >= window) {
+                mismatches += hydro_trend_rate_mv_per_min(&trend) != reference_rate(&history[i + 1 - window], window, sized.sample_period_ms);
+            }
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+}
+
+// A 60 mV/min seep with +-3 mV noise between two stable stretches, sampled every 4 s.
+static void test_seep_warns_and_clears() {
+    hydro_trend_t trend;
+    CHECK_EQ(hydro_trend_init(&trend, &config), ESP_OK);
+
+    const int onset = 100, stop = 200;
+    int warned_at = -1, cleared_at = -1;
+    srand(3);
+    for(int i = 0; i < 400; i++) {
+        int base = i < onset ? 2000 : i < stop ? 2000 - (i - onset) * 4 : 2000 - (stop - onset) * 4;
+        bool warning = hydro_trend_push(&trend, base + rand() % 7 - 3);
+
+        if(i < config.window - 1) {
+            CHECK(!warning);
+        }
+        if(warning && warned_at < 0) {
+            warned_at = i;
+        }
+        if(!warning && warned_at >= 0 && cleared_at < 0) {
+            cleared_at = i;
+        }
+    }
+
+    printf("seep from sample %d to %d: warned at %d, cleared at %d\n", onset, stop, warned_at, cleared_at);
+    CHECK(warned_at > onset && warned_at < onset + config.window);
+    CHECK(cleared_at > stop && cleared_at < stop + config.window);
+    CHECK(hydro_trend_warning(&trend) == false);
+}
+
+int main() {
+    test_rejects_bad_config();
+    test_matches_float_regression();
+    test_seep_warns_and_clears();
+
+    return host_test_result();
+}
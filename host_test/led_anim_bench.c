@@ -0,0 +1,80 @@
+#include "host_test.h"
+#include "led_anim.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Cost of led_anim_render() per frame and per LED for the animations c3_led_blink plays, from one LED to a
+// full 255 LED strip. Frames are 20 ms apart, the default frame rate. Cycles are the host's TSC where there
+// is one and only compare between animations, the device runs at its own clock.
+static const led_anim_keyframe_t fade[] = {
+    { 0xFF0000, 300 }, { 0x00FF00, 300 }, { 0x0000FF, 300 }, { 0xFFFFFF, 300 },
+    { 0x101010, 300 }, { 0xFF8000, 300 }, { 0x00FFFF, 300 }, { 0x800080, 300 },
+};
+
+static uint64_t cycles() {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void bench(const char* name, const led_anim_t* anim, long frames) {
+    static uint8_t rgb[255 * 3];
+    volatile uint8_t sink = 0;
+
+    int64_t start_ns = host_time_ns();
+    uint64_t start_cycles = cycles();
+    for(long f = 0; f < frames; f++) {
+        led_anim_render(anim, f * 20, rgb);
+        sink ^= rgb[f % (anim->led_count * 3)];
+    }
+    double frame_cycles = (double)(cycles() - start_cycles) / frames;
+    double frame_ns = (double)(host_time_ns() - start_ns) / frames;
+
+    printf("%-22s %3u LEDs: %7.1f ns/frame %5.2f ns/LED, %7.1f cycles/frame %5.2f cycles/LED\n", name,
+           anim->led_count, frame_ns, frame_ns / anim->led_count, frame_cycles, frame_cycles / anim->led_count);
+}
+
+int main(int argc, char** argv) {
+    long frames = host_bench_iterations(argc, argv, 200000);
+
+    const uint8_t led_counts[] = { 1, 8, 60, 255 };
+    for(size_t i = 0; i < sizeof(led_counts); i++) {
+        uint8_t leds = led_counts[i];
+        led_anim_t anim;
+
+        led_anim_init(&anim, leds, 128);
+        led_anim_segment_t bar = { .first_led = 0, .led_count = leds, .fill = LED_ANIM_FILL_FULL, .rgb = 0x40C0FF };
+        CHECK_EQ(led_anim_add_segment(&anim, &bar), ESP_OK);
+        bench("steady bar", &anim, frames);
+
+        // What c3_show_levels() draws for eight probes at every level, failed included.
+        led_anim_init(&anim, leds, 128);
+        int segments = leds < LED_ANIM_MAX_SEGMENTS ? leds : LED_ANIM_MAX_SEGMENTS;
+        for(int s = 0; s < segments; s++) {
+            led_anim_segment_t level = led_anim_level_segment(s % 5 - 1);
+            level.first_led = s * leds / segments;
+            level.led_count = (s + 1) * leds / segments - level.first_led;
+            CHECK_EQ(led_anim_add_segment(&anim, &level), ESP_OK);
+        }
+        bench("level bars", &anim, frames);
+
+        led_anim_init(&anim, leds, 128);
+        led_anim_segment_t faded = {
+            .first_led = 0,
+            .led_count = leds,
+            .fill = 200,
+            .pulse_ms = 700,
+            .keyframes = fade,
+            .keyframe_count = sizeof(fade) / sizeof(fade[0]),
+            .loop = true,
+        };
+        CHECK_EQ(led_anim_add_segment(&anim, &faded), ESP_OK);
+        bench("keyframe fade + pulse", &anim, frames);
+    }
+
+    return host_test_result();
+}
@@ -0,0 +1,58 @@
+#include "host_test.h"
+#include "led_strip.h"
+#include "rmt_sim.h"
+
+// Frame rate and time spent blocked in led_strip_refresh() with and without async_refresh, on the modelled RMT
+// channel at WS2812 timing: 30 us per LED plus the 50 us reset. Each frame the caller spends draw_us of its own
+// work first, from none up to a bit more than the transmission takes. Host threads stand in for the RMT
+// interrupt, so the numbers show the shape of the difference rather than what a board measures.
+static void spin_us(double us) {
+    int64_t end_ns = host_time_ns() + (int64_t)(us * 1000);
+    while(host_time_ns() < end_ns) {
+    }
+}
+
+static void run(uint32_t leds, bool async, double draw_us, long frames) {
+    led_strip_config_t strip_config = { .strip_gpio_num = 8, .max_leds = leds };
+    led_strip_rmt_config_t rmt_config = { .resolution_hz = 10000000, .flags.async_refresh = async };
+    led_strip_handle_t strip;
+    CHECK_EQ(led_strip_new_rmt_device(&strip_config, &rmt_config, &strip), ESP_OK);
+
+    int64_t blocked_ns = 0;
+    int64_t start_ns = host_time_ns();
+    for(long f = 0; f < frames; f++) {
+        spin_us(draw_us);
+        for(uint32_t i = 0; i < leds; i++) {
+            led_strip_set_pixel(strip, i, f + i, f * 3 + i, f ^ i);
+        }
+        int64_t refresh_ns = host_time_ns();
+        CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+        blocked_ns += host_time_ns() - refresh_ns;
+    }
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+    // Deleting flushes whatever is still queued.
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+
+    rmt_sim_stats_t stats = rmt_sim_stats();
+    printf("%4" PRIu32 " LEDs %-5s draw %6.0f us: %6.1f fps, refresh blocks %8.1f us per frame\n", leds,
+           async ? "async" : "sync", draw_us, frames * 1e9 / elapsed_ns, (double)blocked_ns / frames / 1000);
+    CHECK_EQ(stats.frames, frames);
+    CHECK_EQ(stats.symbols, frames * (leds * 24 + 1));
+    CHECK_EQ(stats.corrupted, 0);
+}
+
+int main(int argc, char** argv) {
+    long frames = host_bench_iterations(argc, argv, 40);
+
+    const uint32_t led_counts[] = { 1, 60, 255 };
+    for(size_t i = 0; i < sizeof(led_counts) / sizeof(led_counts[0]); i++) {
+        double frame_us = led_counts[i] * 30.0 + 50;
+        const double draws_us[] = { 0, frame_us / 2, frame_us * 1.1 };
+        for(size_t d = 0; d < sizeof(draws_us) / sizeof(draws_us[0]); d++) {
+            run(led_counts[i], false, draws_us[d], frames);
+            run(led_counts[i], true, draws_us[d], frames);
+        }
+    }
+
+    return host_test_result();
+}
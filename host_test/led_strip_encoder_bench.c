@@ -0,0 +1,87 @@
+#include "host_test.h"
+#include "rmt_sim.h"
+#include "led_strip_rmt_encoder.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Cost of turning a frame into RMT symbols with the bit-by-bit bytes encoder and with the symbol table, through
+// rmt_sim.c's copies of the IDF 5.2 encoders. The 24 symbol window is the C3's ping-pong half block, refilled from
+// the RMT interrupt, 512 is a DMA sized one. Cycles are the host's TSC where there is one and only compare the
+// two encoders, the device runs at its own clock.
+#define MAX_LEDS 1000
+
+static uint64_t cycles() {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+typedef struct {
+    double symbols_per_us;
+    double cycles_per_symbol;
+    size_t calls_per_frame;
+} result_t;
+
+static result_t bench(rmt_encoder_handle_t encoder, uint8_t* pixels, size_t bytes, size_t window, long frames) {
+    size_t symbols = 0;
+    size_t calls = 0;
+
+    int64_t start_ns = host_time_ns();
+    uint64_t start_cycles = cycles();
+    for(long f = 0; f < frames; f++) {
+        pixels[f % bytes]++;
+        symbols += rmt_sim_encode(encoder, pixels, bytes, window, NULL, &calls);
+    }
+    uint64_t elapsed_cycles = cycles() - start_cycles;
+    int64_t elapsed_ns = host_time_ns() - start_ns;
+
+    return (result_t) {
+        .symbols_per_us = symbols * 1000.0 / elapsed_ns,
+        .cycles_per_symbol = (double)elapsed_cycles / symbols,
+        .calls_per_frame = calls / frames,
+    };
+}
+
+int main(int argc, char** argv) {
+    // Scaled by strip length so every row encodes about the same number of symbols.
+    long symbols_per_row = host_bench_iterations(argc, argv, 20000000);
+
+    static uint8_t pixels[MAX_LEDS * 3];
+    srand(1);
+    for(size_t i = 0; i < sizeof(pixels); i++) {
+        pixels[i] = rand();
+    }
+
+    const size_t windows[] = { 24, 512 };
+    const size_t led_counts[] = { 60, 300, MAX_LEDS };
+    for(size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        for(size_t l = 0; l < sizeof(led_counts) / sizeof(led_counts[0]); l++) {
+            size_t bytes = led_counts[l] * 3;
+            long frames = symbols_per_row / (bytes * 8) + 1;
+            result_t results[2];
+            for(int table = 0; table < 2; table++) {
+                led_strip_encoder_config_t config = {
+                    .resolution = 10000000,
+                    .led_model = LED_MODEL_WS2812,
+                    .flags.symbol_table = table,
+                };
+                rmt_encoder_handle_t encoder = NULL;
+                CHECK_EQ(rmt_new_led_strip_encoder(&config, &encoder), ESP_OK);
+                results[table] = bench(encoder, pixels, bytes, windows[w], frames);
+                rmt_del_encoder(encoder);
+            }
+
+            printf("window %3zu, %4zu LEDs: bit-by-bit %6.1f sym/us %5.2f cycles/sym, table %6.1f sym/us %5.2f cycles/sym, "
+                   "x%.2f, %zu/%zu encode calls/frame\n", windows[w], led_counts[l],
+                   results[0].symbols_per_us, results[0].cycles_per_symbol, results[1].symbols_per_us,
+                   results[1].cycles_per_symbol, results[1].symbols_per_us / results[0].symbols_per_us,
+                   results[0].calls_per_frame, results[1].calls_per_frame);
+        }
+    }
+
+    return host_test_result();
+}
@@ -0,0 +1,115 @@
+#include "host_test.h"
+#include "rmt_sim.h"
+#include "led_strip_rmt_encoder.h"
+#include <string.h>
+
+// The symbol table encoder against the bit-by-bit one and against WS2812 timing worked out by hand, on channel
+// windows that fill up at every point of a frame: inside a byte, inside a 16 byte stage, on a stage boundary
+// and just before the reset code.
+#define RESOLUTION_HZ 10000000
+#define MAX_LEDS 255
+#define MAX_SYMBOLS (MAX_LEDS * 3 * 8 + 1)
+
+static const rmt_symbol_word_t ws2812_bit0 = { .level0 = 1, .duration0 = 3, .level1 = 0, .duration1 = 9 };
+static const rmt_symbol_word_t ws2812_bit1 = { .level0 = 1, .duration0 = 9, .level1 = 0, .duration1 = 3 };
+static const rmt_symbol_word_t reset_code = { .level0 = 0, .duration0 = 250, .level1 = 0, .duration1 = 250 };
+
+static rmt_encoder_handle_t new_encoder(led_model_t model, bool symbol_table) {
+    led_strip_encoder_config_t config = {
+        .resolution = RESOLUTION_HZ,
+        .led_model = model,
+        .flags.symbol_table = symbol_table,
+    };
+    rmt_encoder_handle_t encoder = NULL;
+    CHECK_EQ(rmt_new_led_strip_encoder(&config, &encoder), ESP_OK);
+
+    return encoder;
+}
+
+static bool same_symbol(rmt_symbol_word_t a, rmt_symbol_word_t b) {
+    return a.level0 == b.level0 && a.duration0 == b.duration0 && a.level1 == b.level1 && a.duration1 == b.duration1;
+}
+
+static int mismatches(const rmt_symbol_word_t* a, const rmt_symbol_word_t* b, size_t count) {
+    int bad = 0;
+    for(size_t i = 0; i < count; i++) {
+        bad += !same_symbol(a[i], b[i]);
+    }
+
+    return bad;
+}
+
+static void fill_pixels(uint8_t* pixels, size_t bytes, unsigned seed) {
+    srand(seed);
+    for(size_t i = 0; i < bytes; i++) {
+        pixels[i] = rand();
+    }
+    // Both ends of the table.
+    pixels[0] = 0x00;
+    pixels[bytes - 1] = 0xFF;
+}
+
+static void test_ws2812_symbols() {
+    static rmt_symbol_word_t expected[MAX_SYMBOLS];
+    static rmt_symbol_word_t out[MAX_SYMBOLS];
+    const uint8_t pixels[] = { 0x80, 0x01, 0xA5 };
+    size_t count = 0;
+    for(size_t i = 0; i < sizeof(pixels); i++) {
+        for(int bit = 7; bit >= 0; bit--) {
+            expected[count++] = (pixels[i] >> bit) & 1 ? ws2812_bit1 : ws2812_bit0;
+        }
+    }
+    expected[count++] = reset_code;
+
+    for(int table = 0; table < 2; table++) {
+        rmt_encoder_handle_t encoder = new_encoder(LED_MODEL_WS2812, table);
+        CHECK_EQ(rmt_sim_encode(encoder, pixels, sizeof(pixels), 64, out, NULL), count);
+        CHECK_EQ(mismatches(out, expected, count), 0);
+        rmt_del_encoder(encoder);
+    }
+}
+
+static void test_table_matches_bytes_encoder() {
+    static uint8_t pixels[MAX_LEDS * 3];
+    static rmt_symbol_word_t bits_out[MAX_SYMBOLS];
+    static rmt_symbol_word_t table_out[MAX_SYMBOLS];
+    // 1, 7 and 129 symbols break inside a byte, 128 on a stage boundary, 48 (the C3's channel memory) and 24
+    // (one RGB LED) every few stages.
+    const size_t windows[] = { 1, 3, 7, 24, 48, 100, 128, 129, 512, MAX_SYMBOLS };
+    // A partial last stage, exactly one stage, and strips that end mid stage.
+    const size_t led_counts[] = { 1, 5, 7, 16, 60, 255 };
+    const led_model_t models[] = { LED_MODEL_WS2812, LED_MODEL_SK6812 };
+
+    for(size_t m = 0; m < sizeof(models) / sizeof(models[0]); m++) {
+        rmt_encoder_handle_t bits = new_encoder(models[m], false);
+        rmt_encoder_handle_t table = new_encoder(models[m], true);
+        for(size_t l = 0; l < sizeof(led_counts) / sizeof(led_counts[0]); l++) {
+            size_t bytes = led_counts[l] * 3;
+            size_t symbols = bytes * 8 + 1;
+            for(size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+                // New pixels every frame, the encoders are reused the way the strip reuses them.
+                fill_pixels(pixels, bytes, m * 1000 + l * 100 + w);
+                size_t bits_calls = 0;
+                size_t table_calls = 0;
+                CHECK_EQ(rmt_sim_encode(bits, pixels, bytes, windows[w], bits_out, &bits_calls), symbols);
+                CHECK_EQ(rmt_sim_encode(table, pixels, bytes, windows[w], table_out, &table_calls), symbols);
+                if(mismatches(bits_out, table_out, symbols) != 0) {
+                    fprintf(stderr, "model %d, %zu LEDs, window %zu: symbols differ\n", models[m], led_counts[l], windows[w]);
+                    host_test_failures++;
+                }
+                CHECK(same_symbol(table_out[symbols - 1], reset_code));
+                // Every full window is handed over before the encoder carries on.
+                CHECK(table_calls >= (symbols + windows[w] - 1) / windows[w]);
+            }
+        }
+        rmt_del_encoder(bits);
+        rmt_del_encoder(table);
+    }
+}
+
+int main() {
+    test_ws2812_symbols();
+    test_table_matches_bytes_encoder();
+
+    return host_test_result();
+}
@@ -0,0 +1,9 @@
+#include <pthread.h>
+
+void app_main();
+
+// As on the linux target, app_main returning leaves the other tasks running until one of them exits.
+int main() {
+    app_main();
+    pthread_exit(NULL);
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Check that tools/mml_compile.py and buzzer_music.c agree on every music string.
+
+Usage: mml_diff.py CLI_PATH PATTERN_FILE [COUNT]
+
+Runs the tunes in PATTERN_FILE and COUNT random strings through both parsers, half of them built from
+commands so they get past the syntax errors. The keyframes must match
+exactly and a string that fails must fail at the same character in both.
+"""
+import os
+import random
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from gen_note_table import note_frequencies  # noqa: E402
+from mml_compile import MusicError, compile_music  # noqa: E402
+
+# Mostly valid commands with the odd stray character, like buzzer_music_fuzz.c.
+ALPHABET = "abcdefgrolt[]#$.0123456789 abcdefgr[]123 x"
+
+
+def value(rng, low, high):
+    """A number in low-high, or one just outside it now and then."""
+    if rng.random() < 0.05:
+        return str(rng.choice((low - 1, high + 1, 0)))
+    return str(rng.randint(low, high))
+
+
+def random_command(rng):
+    """One command, or now and then a stray character or an unmatched repeat."""
+    kind = rng.random()
+    dots = "." * rng.choice((0, 0, 0, 0, 0, 1, 2, 3, 4))
+    if kind < 0.55:
+        whole = rng.choice("abcdefg")
+        modifier = rng.choice(("", "", "#", "$"))
+        if (whole in "cf" and modifier == "$" or whole in "eb" and modifier == "#") and rng.random() < 0.8:
+            modifier = ""
+        return whole + modifier + rng.choice(("", "", value(rng, 1, 64))) + dots
+    if kind < 0.65:
+        return "r" + value(rng, 1, 64) + dots
+    if kind < 0.75:
+        return "o" + value(rng, 0, 8)
+    if kind < 0.85:
+        return "l" + value(rng, 1, 64)
+    if kind < 0.9:
+        return "t" + value(rng, 16, 960)
+    if kind < 0.96:
+        return "[" + random_command(rng) + random_command(rng) + "]" + rng.choice(("", "2", "3", "0", "17"))
+    return rng.choice(ALPHABET + "[]")
+
+
+def random_music(rng):
+    if rng.random() < 0.5:
+        return "".join(rng.choice(ALPHABET) for _ in range(rng.randrange(48)))
+    return rng.choice(("", " ")).join(random_command(rng) for _ in range(rng.randrange(1, 16)))
+
+
+def python_result(music, frequencies):
+    try:
+        return " ".join("%d/%d" % frame for frame in compile_music(music, frequencies))
+    except MusicError as err:
+        return "E%d" % err.idx
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit(__doc__)
+
+    cli, pattern_path = sys.argv[1:3]
+    count = int(sys.argv[3]) if len(sys.argv) == 4 else 20000
+
+    with open(pattern_path) as patterns:
+        tunes = [line.split()[3] for line in patterns if len(line.split()) == 4 and not line.startswith("#")]
+    rng = random.Random(1)
+    strings = tunes + [random_music(rng) for _ in range(count)]
+
+    output = subprocess.run([cli], input="\n".join(strings) + "\n", capture_output=True, text=True, check=True)
+    c_results = output.stdout.split("\n")
+
+    frequencies = note_frequencies()
+    mismatches = 0
+    valid = 0
+    for music, c_result in zip(strings, c_results):
+        expected = python_result(music, frequencies)
+        valid += not expected.startswith("E")
+        if c_result != expected:
+            mismatches += 1
+            if mismatches <= 10:
+                print("mismatch for %r:\n  python %s\n  c      %s" % (music, expected, c_result))
+
+    print("mml_diff: %d strings, %d tunes, %d valid, %d mismatches" % (len(strings), len(tunes), valid, mismatches))
+    sys.exit(1 if mismatches or len(c_results) < len(strings) else 0)
+
+
+if __name__ == "__main__":
+    main()
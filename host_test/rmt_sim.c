@@ -0,0 +1,390 @@
+#include "rmt_sim.h"
+#include "esp_check.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_QUEUE_DEPTH 8
+#define MAX_WINDOW_SYMBOLS 1024
+
+typedef struct {
+    rmt_encoder_handle_t encoder;
+    const uint8_t* payload;
+    size_t bytes;
+    uint32_t checksum;
+} transaction_t;
+
+struct rmt_channel_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t worker;
+    bool quit;
+    bool enabled;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t queue_depth;
+    transaction_t queue[MAX_QUEUE_DEPTH];
+    size_t head;
+    size_t count;
+    rmt_tx_done_callback_t on_trans_done;
+    void* user_data;
+    // The window the encoders write to, mem_off is the next free symbol.
+    rmt_symbol_word_t* mem;
+    size_t mem_off;
+    size_t mem_end;
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static rmt_sim_stats_t stats;
+
+rmt_sim_stats_t rmt_sim_stats() {
+    pthread_mutex_lock(&stats_lock);
+    rmt_sim_stats_t copy = stats;
+    pthread_mutex_unlock(&stats_lock);
+
+    return copy;
+}
+
+static uint32_t checksum(const uint8_t* data, size_t len) {
+    uint32_t sum = 2166136261u;
+    for(size_t i = 0; i < len; i++) {
+        sum = (sum ^ data[i]) * 16777619u;
+    }
+
+    return sum;
+}
+
+static uint64_t encode_frame(struct rmt_channel_t* channel, rmt_encoder_handle_t encoder, const void* data, size_t size,
+                             rmt_symbol_word_t* out, size_t* count_out, size_t* calls_out) {
+    rmt_symbol_word_t window[MAX_WINDOW_SYMBOLS];
+    channel->mem = window;
+    channel->mem_end = channel->mem_block_symbols < MAX_WINDOW_SYMBOLS ? channel->mem_block_symbols : MAX_WINDOW_SYMBOLS;
+
+    uint64_t ticks = 0;
+    size_t count = 0;
+    rmt_encode_state_t state;
+    encoder->reset(encoder);
+    do {
+        channel->mem_off = 0;
+        encoder->encode(encoder, channel, data, size, &state);
+        for(size_t i = 0; i < channel->mem_off; i++) {
+            ticks += window[i].duration0 + window[i].duration1;
+        }
+        if(out != NULL) {
+            memcpy(&out[count], window, channel->mem_off * sizeof(rmt_symbol_word_t));
+        }
+        count += channel->mem_off;
+        if(calls_out != NULL) {
+            (*calls_out)++;
+        }
+    } while(!(state & RMT_ENCODING_COMPLETE));
+
+    *count_out = count;
+    return ticks;
+}
+
+size_t rmt_sim_encode(rmt_encoder_handle_t encoder, const void* data, size_t size, size_t window_symbols,
+                      rmt_symbol_word_t* out, size_t* calls_out) {
+    struct rmt_channel_t channel = { .mem_block_symbols = window_symbols };
+    size_t count;
+    encode_frame(&channel, encoder, data, size, out, &count, calls_out);
+
+    return count;
+}
+
+static void sleep_until(const struct timespec* deadline) {
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) != 0) {
+    }
+}
+
+static void* worker_main(void* args) {
+    struct rmt_channel_t* channel = args;
+
+    pthread_mutex_lock(&channel->lock);
+    while(!channel->quit) {
+        if(channel->count == 0) {
+            pthread_cond_wait(&channel->cond, &channel->lock);
+            continue;
+        }
+        transaction_t transaction = channel->queue[channel->head];
+        pthread_mutex_unlock(&channel->lock);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        size_t symbols;
+        uint64_t ticks = encode_frame(channel, transaction.encoder, transaction.payload, transaction.bytes, NULL, &symbols, NULL);
+        uint64_t end_ns = deadline.tv_nsec + ticks * 1000000000 / channel->resolution_hz;
+        deadline.tv_sec += end_ns / 1000000000;
+        deadline.tv_nsec = end_ns % 1000000000;
+        sleep_until(&deadline);
+
+        pthread_mutex_lock(&stats_lock);
+        stats.frames++;
+        stats.symbols += symbols;
+        stats.corrupted += checksum(transaction.payload, transaction.bytes) != transaction.checksum;
+        pthread_mutex_unlock(&stats_lock);
+
+        pthread_mutex_lock(&channel->lock);
+        if(channel->on_trans_done != NULL) {
+            rmt_tx_done_event_data_t event = { .num_symbols = symbols };
+            channel->on_trans_done(channel, &event, channel->user_data);
+        }
+        channel->head = (channel->head + 1) % channel->queue_depth;
+        channel->count--;
+        pthread_cond_broadcast(&channel->cond);
+    }
+    pthread_mutex_unlock(&channel->lock);
+
+    return NULL;
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t* config, rmt_channel_handle_t* ret_chan) {
+    if(config->resolution_hz == 0 || config->mem_block_symbols == 0 || config->trans_queue_depth == 0
+            || config->trans_queue_depth > MAX_QUEUE_DEPTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct rmt_channel_t* channel = calloc(1, sizeof(struct rmt_channel_t));
+    if(channel == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_mutex_init(&channel->lock, NULL);
+    pthread_cond_init(&channel->cond, NULL);
+    channel->resolution_hz = config->resolution_hz;
+    channel->mem_block_symbols = config->mem_block_symbols;
+    channel->queue_depth = config->trans_queue_depth;
+    pthread_create(&channel->worker, NULL, worker_main, channel);
+
+    pthread_mutex_lock(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_lock);
+
+    *ret_chan = channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) {
+    pthread_mutex_lock(&channel->lock);
+    if(channel->enabled) {
+        pthread_mutex_unlock(&channel->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    channel->quit = true;
+    pthread_cond_broadcast(&channel->cond);
+    pthread_mutex_unlock(&channel->lock);
+
+    pthread_join(channel->worker, NULL);
+    pthread_cond_destroy(&channel->cond);
+    pthread_mutex_destroy(&channel->lock);
+    free(channel);
+
+    return ESP_OK;
+}
+
+static esp_err_t set_enabled(rmt_channel_handle_t channel, bool enabled) {
+    pthread_mutex_lock(&channel->lock);
+    esp_err_t ret = channel->enabled == enabled ? ESP_ERR_INVALID_STATE : ESP_OK;
+    channel->enabled = enabled;
+    pthread_mutex_unlock(&channel->lock);
+
+    return ret;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel) {
+    return set_enabled(channel, true);
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel) {
+    return set_enabled(channel, false);
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t* cbs, void* user_data) {
+    pthread_mutex_lock(&tx_channel->lock);
+    esp_err_t ret = tx_channel->enabled ? ESP_ERR_INVALID_STATE : ESP_OK;
+    if(ret == ESP_OK) {
+        tx_channel->on_trans_done = cbs->on_trans_done;
+        tx_channel->user_data = user_data;
+    }
+    pthread_mutex_unlock(&tx_channel->lock);
+
+    return ret;
+}
+
+// Like the driver, a full transaction queue blocks the caller until the oldest frame is out.
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void* payload, size_t payload_bytes,
+                       const rmt_transmit_config_t* config) {
+    pthread_mutex_lock(&tx_channel->lock);
+    if(!tx_channel->enabled) {
+        pthread_mutex_unlock(&tx_channel->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    while(tx_channel->count == tx_channel->queue_depth) {
+        pthread_cond_wait(&tx_channel->cond, &tx_channel->lock);
+    }
+    tx_channel->queue[(tx_channel->head + tx_channel->count) % tx_channel->queue_depth] = (transaction_t) {
+        .encoder = encoder,
+        .payload = payload,
+        .bytes = payload_bytes,
+        .checksum = checksum(payload, payload_bytes),
+    };
+    tx_channel->count++;
+    pthread_cond_broadcast(&tx_channel->cond);
+    pthread_mutex_unlock(&tx_channel->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms) {
+    pthread_mutex_lock(&tx_channel->lock);
+    while(tx_channel->count > 0) {
+        pthread_cond_wait(&tx_channel->cond, &tx_channel->lock);
+    }
+    pthread_mutex_unlock(&tx_channel->lock);
+
+    return ESP_OK;
+}
+
+// The IDF 5.2 bytes encoder: one symbol per bit straight into channel memory, resuming mid byte on a full window.
+typedef struct {
+    rmt_encoder_t base;
+    size_t last_bit_index;
+    size_t last_byte_index;
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    bool msb_first;
+} bytes_encoder_t;
+
+static size_t encode_bytes(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* primary_data, size_t data_size,
+                           rmt_encode_state_t* ret_state) {
+    bytes_encoder_t* bytes_encoder = __containerof(encoder, bytes_encoder_t, base);
+    const uint8_t* raw = primary_data;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t byte_index = bytes_encoder->last_byte_index;
+    size_t bit_index = bytes_encoder->last_bit_index;
+    size_t mem_want = (data_size - byte_index - 1) * 8 + (8 - bit_index);
+    size_t mem_have = channel->mem_end - channel->mem_off;
+    size_t encode_len = mem_want < mem_have ? mem_want : mem_have;
+    bool truncated = mem_have < mem_want;
+
+    size_t len = encode_len;
+    while(len > 0) {
+        uint8_t cur_byte = raw[byte_index];
+        while(len > 0 && bit_index < 8) {
+            bool bit = bytes_encoder->msb_first ? cur_byte & (0x80 >> bit_index) : cur_byte & (1 << bit_index);
+            channel->mem[channel->mem_off++] = bit ? bytes_encoder->bit1 : bytes_encoder->bit0;
+            len--;
+            bit_index++;
+        }
+        if(bit_index >= 8) {
+            byte_index++;
+            bit_index = 0;
+        }
+    }
+
+    if(byte_index >= data_size) {
+        bytes_encoder->last_byte_index = 0;
+        bytes_encoder->last_bit_index = 0;
+        state |= RMT_ENCODING_COMPLETE;
+    } else {
+        bytes_encoder->last_byte_index = byte_index;
+        bytes_encoder->last_bit_index = bit_index;
+    }
+    if(truncated) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+
+    *ret_state = state;
+    return encode_len;
+}
+
+static esp_err_t reset_bytes(rmt_encoder_t* encoder) {
+    bytes_encoder_t* bytes_encoder = __containerof(encoder, bytes_encoder_t, base);
+    bytes_encoder->last_byte_index = 0;
+    bytes_encoder->last_bit_index = 0;
+
+    return ESP_OK;
+}
+
+// The IDF 5.2 copy encoder: symbols copied one by one, resuming at the first one that did not fit.
+typedef struct {
+    rmt_encoder_t base;
+    size_t last_symbol_index;
+} copy_encoder_t;
+
+static size_t encode_copy(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* primary_data, size_t data_size,
+                          rmt_encode_state_t* ret_state) {
+    copy_encoder_t* copy_encoder = __containerof(encoder, copy_encoder_t, base);
+    const rmt_symbol_word_t* symbols = primary_data;
+    size_t symbol_count = data_size / sizeof(rmt_symbol_word_t);
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t symbol_index = copy_encoder->last_symbol_index;
+    size_t mem_want = symbol_count - symbol_index;
+    size_t mem_have = channel->mem_end - channel->mem_off;
+    size_t encode_len = mem_want < mem_have ? mem_want : mem_have;
+    bool truncated = mem_have < mem_want;
+
+    size_t len = encode_len;
+    while(len > 0) {
+        channel->mem[channel->mem_off++] = symbols[symbol_index++];
+        len--;
+    }
+
+    if(symbol_index == symbol_count) {
+        copy_encoder->last_symbol_index = 0;
+        state |= RMT_ENCODING_COMPLETE;
+    } else {
+        copy_encoder->last_symbol_index = symbol_index;
+    }
+    if(truncated) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+
+    *ret_state = state;
+    return encode_len;
+}
+
+static esp_err_t reset_copy(rmt_encoder_t* encoder) {
+    __containerof(encoder, copy_encoder_t, base)->last_symbol_index = 0;
+
+    return ESP_OK;
+}
+
+static esp_err_t del_encoder(rmt_encoder_t* encoder) {
+    free(encoder);
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder) {
+    bytes_encoder_t* encoder = calloc(1, sizeof(bytes_encoder_t));
+    if(encoder == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    encoder->base = (rmt_encoder_t) { .encode = encode_bytes, .reset = reset_bytes, .del = del_encoder };
+    encoder->bit0 = config->bit0;
+    encoder->bit1 = config->bit1;
+    encoder->msb_first = config->flags.msb_first;
+
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder) {
+    copy_encoder_t* encoder = calloc(1, sizeof(copy_encoder_t));
+    if(encoder == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    encoder->base = (rmt_encoder_t) { .encode = encode_copy, .reset = reset_copy, .del = del_encoder };
+
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) {
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder) {
+    return encoder->reset(encoder);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "driver/rmt_tx.h"
+
+// Host model of an RMT TX channel for the led_strip fork. The encoders are the IDF 5.2 bytes and copy
+// encoders' loops, writing into a channel memory window that drains and refills. A channel has a worker
+// thread that encodes each queued frame and then holds the line for as long as its symbols last, so
+// refresh blocking and frame rates come out as they would at the strip's bit rate.
+
+typedef struct {
+    long frames;
+    long symbols;
+    // Frames whose pixel buffer changed between rmt_transmit() and the end of the transmission.
+    long corrupted;
+} rmt_sim_stats_t;
+
+// Counters of the most recently created channel, reset when a channel is created.
+rmt_sim_stats_t rmt_sim_stats();
+
+// Runs one frame through an encoder the way the driver does: encode until the window of window_symbols is
+// full, let it drain, go again until the encoder completes. The symbols go to out when it is not NULL, the
+// number of encode calls to calls_out. Returns the symbol count.
+size_t rmt_sim_encode(rmt_encoder_handle_t encoder, const void* data, size_t size, size_t window_symbols,
+                      rmt_symbol_word_t* out, size_t* calls_out);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+
+const char* esp_err_to_name(esp_err_t code);
+
+void shim_error_check_failed(esp_err_t code, const char* file, int line, const char* expression, bool abort_on_error);
+
+#define ESP_ERROR_CHECK(x) do { \
+    esp_err_t _err = (x); \
+    if(_err != ESP_OK) { \
+        shim_error_check_failed(_err, __FILE__, __LINE__, #x, true); \
+    } \
+} while(0)
+
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) ({ \
+    esp_err_t _err = (x); \
+    if(_err != ESP_OK) { \
+        shim_error_check_failed(_err, __FILE__, __LINE__, #x, false); \
+    } \
+    _err; \
+})
@@ -0,0 +1,3 @@
+#include "esp_log.h"
+
+esp_log_level_t esp_log_host_level = ESP_LOG_INFO;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t size;
+} esp_partition_t;
+
+#define ESP_PARTITION_TYPE_DATA 1
+#define ESP_PARTITION_SUBTYPE_ANY 0xff
+
+// Backed by a RAM image in flash_sim.c.
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label);
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size);
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size);
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
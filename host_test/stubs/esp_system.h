@@ -0,0 +1,4 @@
+#pragma once
+
+// Exits the process, there is nothing to restart into on the host.
+void esp_restart();
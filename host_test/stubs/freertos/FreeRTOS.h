@@ -0,0 +1,39 @@
+#pragma once
+
+// Enough of the FreeRTOS API for the linux target code paths, on pthreads. Implemented in freertos_shim.c.
+// Ticks are milliseconds and critical sections take one process wide lock.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "esp_system.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks) ((TickType_t)(ticks))
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void shim_enter_critical();
+void shim_exit_critical();
+
+#define portENTER_CRITICAL(mux) ((void)(mux), shim_enter_critical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), shim_exit_critical())
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux), shim_enter_critical())
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux), shim_exit_critical())
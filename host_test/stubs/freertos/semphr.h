@@ -0,0 +1,20 @@
+#pragma once
+
+#include "freertos/queue.h"
+
+// As in FreeRTOS, a semaphore is a queue of empty items.
+typedef QueueHandle_t SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    QueueHandle_t queue = xQueueCreate(max_count, 0);
+    for(UBaseType_t i = 0; i < initial_count; i++) {
+        xQueueSend(queue, NULL, 0);
+    }
+
+    return queue;
+}
+
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+#define xSemaphoreTake(semaphore, ticks) xQueueReceive((semaphore), NULL, (ticks))
+#define xSemaphoreGive(semaphore) xQueueSend((semaphore), NULL, 0)
+#define xSemaphoreGiveFromISR(semaphore, woken) xQueueSendFromISR((semaphore), NULL, (woken))
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct shim_stream* StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+
+void vStreamBufferDelete(StreamBufferHandle_t stream);
+
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void* data, size_t length, TickType_t ticks);
+
+// Blocks while the buffer is empty, until the trigger level is reached or the timeout passes.
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void* data, size_t length, TickType_t ticks);
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t stream);
+
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t stream);
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t stream);
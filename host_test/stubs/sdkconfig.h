@@ -0,0 +1,32 @@
+#pragma once
+
+// Kconfig defaults from main/Kconfig.projbuild, on the linux target. The event mode app is built with
+// CONFIG_HYDRO_SENSOR_MODE_EVENT defined on the command line.
+#define CONFIG_IDF_TARGET_LINUX 1
+
+#define CONFIG_HYDRO_SENSOR_GPIO "0"
+#define CONFIG_HYDRO_LOW_LEVEL_MV 2340
+#define CONFIG_HYDRO_MED_LEVEL_MV 1875
+#define CONFIG_HYDRO_HIGH_LEVEL_MV 1250
+
+#ifndef CONFIG_HYDRO_SENSOR_MODE_EVENT
+#define CONFIG_HYDRO_SENSOR_MODE_STREAM 1
+#define CONFIG_HYDRO_TREND 1
+#define CONFIG_HYDRO_HISTORY 1
+#endif
+
+#define CONFIG_HYDRO_STREAM_SAMPLE_FREQ_HZ 1000
+#define CONFIG_HYDRO_STREAM_RING_SAMPLES 1024
+#define CONFIG_HYDRO_STREAM_BLOCK_SAMPLES 128
+#define CONFIG_HYDRO_TREND_WINDOW_SAMPLES 16
+#define CONFIG_HYDRO_TREND_WARN_MV_PER_MIN 30
+
+#define CONFIG_BUZZER_PATTERN_POOL_PATTERNS 8
+#define CONFIG_BUZZER_PATTERN_POOL_FRAMES 512
+
+#define CONFIG_C3_LED_COUNT 1
+#define CONFIG_C3_LED_FRAME_RATE_HZ 50
+#define CONFIG_C3_LED_BRIGHTNESS 128
+
+#define CONFIG_EVENT_BUS_QUEUE_DEPTH 16
+#define CONFIG_EVENT_TRACE_RECORDS 256
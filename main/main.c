@@ -1,79 +1,451 @@
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "hydro_sensor.h"
+#include "hydro_stream.h"
+#include "hydro_array.h"
+#include "hydro_sleep.h"
+#include "hydro_trend.h"
+#if CONFIG_HYDRO_SENSOR_MODE_SLEEP
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#endif
 #include "buzzer_control.h"
-#include "buzzer_music.h"
+#include "buzzer_patterns.h"
 #include "c3_led_blink.h"
+#include "event_trace.h"
+#include "event_bus.h"
+#include "hydro_history.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <stdlib.h>
+#include "hydro_replay.h"
+#include "buzzer_render.h"
+#endif
+
+#define POLL_PERIOD_MS 4000
 
 static const char* TAG = "LEAK_DETECTOR";
 static hydro_level_t sensor_level;
-static buzzer_pattern_t** patterns;
+// Compiled from buzzer_patterns.mml at build time, so they play straight from flash.
+static const buzzer_pattern_t* const patterns[] = {
+    [HYDRO_LEVEL_OK] = NULL,
+    [HYDRO_LEVEL_LOW] = &pattern_level_low,
+    [HYDRO_LEVEL_MED] = &pattern_level_med,
+    [HYDRO_LEVEL_HIGH] = &pattern_level_high,
+};
+
+#if CONFIG_IDF_TARGET_LINUX
+// BUZZER_RENDER_DIR=DIR writes each tune there as a WAV file, to be heard without a board.
+static void render_patterns(const char* dir) {
+    if(dir == NULL) {
+        return;
+    }
+
+    const struct {
+        const char* name;
+        const buzzer_pattern_t* pattern;
+    } tunes[] = {
+        { "start", &pattern_start },
+        { "level_low", &pattern_level_low },
+        { "level_med", &pattern_level_med },
+        { "level_high", &pattern_level_high },
+    };
+
+    char path[256];
+    for(int i = 0; i < sizeof(tunes) / sizeof(tunes[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s.wav", dir, tunes[i].name);
+        ESP_ERROR_CHECK_WITHOUT_ABORT(buzzer_render_wav(tunes[i].pattern, 1, path));
+    }
+}
+#endif
+
+#if CONFIG_HYDRO_SENSOR_MODE_STREAM || CONFIG_HYDRO_SENSOR_MODE_EVENT
+static hydro_sample_t sample_block[CONFIG_HYDRO_STREAM_BLOCK_SAMPLES];
+static hydro_array_t probes;
+static const hydro_filter_config_t probe_filter_config = HYDRO_FILTER_STREAM_CONFIG();
+// Stream modes keep time by sample timestamps, which lets a replay run in virtual time.
+static int64_t stream_time_us;
+
+static hydro_level_t read_stream_level() {
+    size_t count = hydro_stream_read(sample_block, CONFIG_HYDRO_STREAM_BLOCK_SAMPLES, portMAX_DELAY);
+    if(count == 0) {
+        return HYDRO_LEVEL_ERR;
+    }
+
+    stream_time_us = sample_block[count - 1].timestamp_us;
+    uint32_t changed = hydro_array_push(&probes, sample_block, count);
+    for(uint8_t slot = 0; slot < probes.count; slot++) {
+        if(changed & (1UL << slot)) {
+            ESP_LOGI(TAG, "probe %u level: %d", slot, probes.levels[slot]);
+        }
+    }
+
+    return hydro_array_worst_level(&probes);
+}
+
+// Event mode only watches the first probe since the threshold window covers a single channel.
+static hydro_level_t primary_probe_level() {
+    return (hydro_level_t)probes.levels[0];
+}
+#endif
+
+#if CONFIG_HYDRO_SENSOR_MODE_EVENT
+// Long enough for the stream filter's median, IIR and dwell to settle at the default sample rate.
+#define CROSSING_CONFIRM_MS 200
+
+// A crossing only says one sample left the band. The level still comes from the probe's filter, so a
+// noise spike is held to the same median, hysteresis and dwell as in stream mode.
+static hydro_level_t confirm_crossing(const hydro_threshold_event_t* event, hydro_level_t level) {
+    int64_t deadline_us = event->timestamp_us + CROSSING_CONFIRM_MS * 1000;
+
+    do {
+        if(read_stream_level() != HYDRO_LEVEL_ERR && primary_probe_level() != level) {
+            break;
+        }
+    } while(stream_time_us < deadline_us && !hydro_stream_ended());
+
+    return primary_probe_level();
+}
+#endif
+
+#if CONFIG_HYDRO_SENSOR_MODE_SLEEP
+static RTC_DATA_ATTR hydro_sleep_state_t sleep_state;
+static const hydro_sleep_config_t sleep_config = HYDRO_SLEEP_DEFAULT_CONFIG();
+static const hydro_filter_config_t sleep_filter_config = HYDRO_FILTER_POLL_CONFIG();
+
+static void enter_deep_sleep() {
+    ESP_LOGD(TAG, "sleeping after wake %" PRIu32, sleep_state.wake_count);
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_state.interval_s * 1000000);
+    esp_deep_sleep_start();
+}
+
+static hydro_wake_action_t sample_after_wake(bool cold_boot) {
+    if(cold_boot || !hydro_sleep_state_valid(&sleep_state)) {
+        ESP_ERROR_CHECK(hydro_sleep_state_init(&sleep_state, &sleep_config, &sleep_filter_config));
+    }
+
+    ESP_ERROR_CHECK(init_hydro_sensor());
+
+    uint16_t samples[CONFIG_HYDRO_SLEEP_BURST_SAMPLES];
+    esp_err_t ret = read_hydro_sensor_mv(samples, CONFIG_HYDRO_SLEEP_BURST_SAMPLES);
+    if(ret != ESP_OK) {
+        ESP_LOGI(TAG, "failed to read sensor");
+        return HYDRO_WAKE_SLEEP;
+    }
+
+    return hydro_sleep_decide(&sleep_state, samples, CONFIG_HYDRO_SLEEP_BURST_SAMPLES);
+}
+#endif
+
+#if CONFIG_HYDRO_TREND
+static hydro_trend_t trend;
+static const hydro_trend_config_t trend_config = HYDRO_TREND_DEFAULT_CONFIG(POLL_PERIOD_MS);
+
+static void update_trend(uint16_t mv) {
+    bool was_warning = hydro_trend_warning(&trend);
+    bool warning = hydro_trend_push(&trend, mv);
+    if(warning != was_warning) {
+        int32_t rate = hydro_trend_rate_mv_per_min(&trend);
+        event_trace_record(TRACE_HYDRO_TREND, warning, rate);
+        ESP_LOGI(TAG, "wetting trend %s at %" PRId32 " mV/min", warning ? "warning" : "cleared", rate);
+    }
+}
+
+// A seep that is still above the low threshold alarms as low while the warning holds.
+static hydro_level_t escalate_for_trend(hydro_level_t level) {
+    return (level == HYDRO_LEVEL_OK && hydro_trend_warning(&trend)) ? HYDRO_LEVEL_LOW : level;
+}
+#endif
+
+#if CONFIG_HYDRO_HISTORY
+#define HISTORY_PERIOD_MS 1000
+
+static bool history_ready;
+static uint32_t history_base_s;
+
+static void init_history() {
+    esp_err_t ret = hydro_history_init("history");
+    if(ret != ESP_OK) {
+        ESP_LOGI(TAG, "history disabled: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    // Nothing sets the wall clock yet, so the log keeps its own timeline in seconds across reboots.
+    history_base_s = hydro_history_latest() + 1;
+    history_ready = true;
+}
+
+static void record_history(uint16_t mv, int64_t now_ms) {
+    static int64_t last_ms = -HISTORY_PERIOD_MS;
+
+    if(!history_ready || now_ms - last_ms < HISTORY_PERIOD_MS) {
+        return;
+    }
+
+    last_ms = now_ms;
+    ESP_ERROR_CHECK_WITHOUT_ABORT(hydro_history_append(history_base_s + now_ms / 1000, mv));
+}
+#endif
+
+// A strip gives every probe its own level bar, a single LED blinks while any level is up.
+static void show_level(const event_bus_level_t* report) {
+#if CONFIG_C3_LED_COUNT > 1
+    if(report->probe_count > 0) {
+        c3_show_levels(report->probe_levels, report->probe_count);
+    } else {
+        c3_show_levels(&report->level, 1);
+    }
+#else
+    if(report->level > HYDRO_LEVEL_OK) {
+        c3_blink_color(255, 0, 0, 400);
+    } else {
+        c3_stop_blink();
+    }
+#endif
+}
+
+// The sensor loop only publishes. The buzzer, the status LED and telemetry each take level events off
+// their own subscription in their own task, so none of them holds up the loop or each other.
+static void alarm_task(void* args) {
+    event_bus_subscriber_t* subscriber = args;
+    event_bus_event_t event;
+
+    while(true) {
+        if(event_bus_wait(subscriber, &event, portMAX_DELAY)) {
+            const buzzer_pattern_t* pattern = patterns[event.level.level];
+            if(pattern != NULL) {
+                buzzer_control_play_pattern(pattern, BUZZER_PRIORITY_ALARM);
+            }
+        }
+    }
+}
+
+static void status_led_task(void* args) {
+    event_bus_subscriber_t* subscriber = args;
+    event_bus_event_t event;
+
+    while(true) {
+        if(event_bus_wait(subscriber, &event, portMAX_DELAY)) {
+            show_level(&event.level);
+        }
+    }
+}
 
-static buzzer_pattern_t* start_pattern;
+static void telemetry_task(void* args) {
+    event_bus_subscriber_t* subscriber = args;
+    event_bus_event_t event;
+    uint32_t max_latency_us = 0;
+
+    while(true) {
+        if(!event_bus_wait(subscriber, &event, portMAX_DELAY)) {
+            continue;
+        }
+
+        uint32_t latency_us = event_bus_now_us() - event.timestamp_us;
+        if(latency_us > max_latency_us) {
+            max_latency_us = latency_us;
+        }
+
+        // Level changes are rare, so that is when the trace leading up to one gets printed for decoding.
+        if(event.level.changed) {
+            event_trace_dump();
+            ESP_LOGI(TAG, "level %d delivered in %" PRIu32 " us (max %" PRIu32 "), %" PRIu32 " dropped",
+                     event.level.level, latency_us, max_latency_us, event_bus_dropped(subscriber));
+        }
+    }
+}
 
-static void init_buzzer_patterns() {
-    patterns = (buzzer_pattern_t**)calloc(4, sizeof(buzzer_pattern_t*));
+static void start_consumer(TaskFunction_t task, const char* name, uint32_t stack_size) {
+    event_bus_subscriber_t* subscriber;
+    ESP_ERROR_CHECK(event_bus_subscribe(EVENT_BUS_MASK(EVENT_BUS_LEVEL), &subscriber));
+    xTaskCreate(task, name, stack_size, subscriber, 5, NULL);
+}
 
-    patterns[HYDRO_LEVEL_OK] = NULL;
-    ESP_ERROR_CHECK(parse_music_str("o4l2cr2c", &patterns[HYDRO_LEVEL_LOW]));
-    ESP_ERROR_CHECK(parse_music_str("o5l2co4f#", &patterns[HYDRO_LEVEL_MED]));
-    ESP_ERROR_CHECK(parse_music_str("l4o6cf#o7co6f#c", &patterns[HYDRO_LEVEL_HIGH]));
+static void handle_sensor_level(hydro_level_t level) {
+    static hydro_level_t last_level = HYDRO_LEVEL_ERR;
 
-    for(int i=1; i<=HYDRO_LEVEL_HIGH; i++) {
-        patterns[i]->waveform = BUZZER_WAV_SAW;
-        patterns[i]->loop = false;
+    if(level == HYDRO_LEVEL_ERR) {
+        ESP_LOGI(TAG, "failed to read sensor");
+        return;
     }
 
-    ESP_ERROR_CHECK(parse_music_str("o5l4cego6c", &start_pattern));
-    start_pattern->waveform = BUZZER_WAV_SQUARE;
-    start_pattern->loop = false;
+    ESP_LOGD(TAG, "sensor level: %d", level);
+
+    event_bus_event_t event = {
+        .type = EVENT_BUS_LEVEL,
+        .level = {
+            .level = level,
+            .changed = level != last_level,
+        },
+    };
+    last_level = level;
+#if CONFIG_HYDRO_SENSOR_MODE_STREAM
+    event.level.probe_count = probes.count < EVENT_BUS_MAX_PROBES ? probes.count : EVENT_BUS_MAX_PROBES;
+    memcpy(event.level.probe_levels, probes.levels, event.level.probe_count);
+#endif
+
+    ESP_ERROR_CHECK_WITHOUT_ABORT(event_bus_publish(&event));
 }
 
 void app_main(void)
 {
     esp_log_level_set("*", ESP_LOG_INFO);
 
+#if CONFIG_HYDRO_SENSOR_MODE_SLEEP
+    // Decide before touching the actuators so a quiet wake costs only the ADC burst.
+    bool cold_boot = esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER;
+    if(sample_after_wake(cold_boot) == HYDRO_WAKE_SLEEP && !cold_boot) {
+        enter_deep_sleep();
+    }
+#endif
+
     ESP_ERROR_CHECK_WITHOUT_ABORT(buzzer_control_init());
-    ESP_ERROR_CHECK_WITHOUT_ABORT(c3_led_blink_init());
+    // The detector still runs without its status LED.
+    bool led_ok = ESP_ERROR_CHECK_WITHOUT_ABORT(c3_led_blink_init()) == ESP_OK;
+    start_consumer(alarm_task, "alarm", 2048);
+    start_consumer(status_led_task, "status_led", 2048);
+    start_consumer(telemetry_task, "telemetry", 3072);
+#if CONFIG_IDF_TARGET_LINUX
+    render_patterns(getenv("BUZZER_RENDER_DIR"));
+#endif
 
-    init_buzzer_patterns();
+#if CONFIG_HYDRO_SENSOR_MODE_SLEEP
+    if(!cold_boot) {
+        handle_sensor_level(sleep_state.reported_level);
+        vTaskDelay(POLL_PERIOD_MS / portTICK_PERIOD_MS);
+        enter_deep_sleep();
+    }
+#endif
 
+#if CONFIG_HYDRO_SENSOR_MODE_STREAM || CONFIG_HYDRO_SENSOR_MODE_EVENT
+    hydro_stream_config_t stream_config = HYDRO_STREAM_DEFAULT_CONFIG();
+    ESP_ERROR_CHECK(hydro_stream_channels_from_gpios(CONFIG_HYDRO_SENSOR_GPIO, &stream_config));
+    ESP_ERROR_CHECK(hydro_array_init(&probes, stream_config.channels, stream_config.channel_count, &probe_filter_config));
+#if CONFIG_IDF_TARGET_LINUX
+    ESP_ERROR_CHECK(hydro_replay_open(getenv("HYDRO_REPLAY_TRACE"), &stream_config));
+#endif
+    ESP_ERROR_CHECK(hydro_stream_start(&stream_config));
+#elif CONFIG_HYDRO_SENSOR_MODE_ONESHOT
     ESP_ERROR_CHECK(init_hydro_sensor());
-    ESP_ERROR_CHECK(buzzer_control_play_pattern(start_pattern));
+#endif
+#if CONFIG_HYDRO_TREND
+    ESP_ERROR_CHECK(hydro_trend_init(&trend, &trend_config));
+#endif
+#if CONFIG_HYDRO_HISTORY
+    init_history();
+#endif
+    ESP_ERROR_CHECK(buzzer_control_play_pattern(&pattern_start, BUZZER_PRIORITY_NOTIFY));
 
-    ESP_ERROR_CHECK(c3_blink_color(255, 0, 0, 400));
-    vTaskDelay(400 / portTICK_PERIOD_MS);
-    ESP_ERROR_CHECK(c3_blink_color(0, 255, 0, 400));
-    vTaskDelay(400 / portTICK_PERIOD_MS);
-    ESP_ERROR_CHECK(c3_blink_color(0, 0, 255, 400));
-    vTaskDelay(400 / portTICK_PERIOD_MS);
-    ESP_ERROR_CHECK(c3_stop_blink());
+    if(led_ok) {
+        ESP_ERROR_CHECK_WITHOUT_ABORT(c3_blink_color(255, 0, 0, 400));
+        vTaskDelay(400 / portTICK_PERIOD_MS);
+        ESP_ERROR_CHECK_WITHOUT_ABORT(c3_blink_color(0, 255, 0, 400));
+        vTaskDelay(400 / portTICK_PERIOD_MS);
+        ESP_ERROR_CHECK_WITHOUT_ABORT(c3_blink_color(0, 0, 255, 400));
+        vTaskDelay(400 / portTICK_PERIOD_MS);
+        ESP_ERROR_CHECK_WITHOUT_ABORT(c3_stop_blink());
+    }
+
+#if CONFIG_HYDRO_SENSOR_MODE_STREAM
+    int64_t last_handled_ms = 0;
+#if CONFIG_HYDRO_TREND
+    int64_t last_trend_ms = -POLL_PERIOD_MS;
+#endif
+    sensor_level = HYDRO_LEVEL_ERR;
 
     while(true) {
-        sensor_level = read_hydro_sensor();
+        // Blocks are cheap to classify, only act on a change or once per poll period.
+        hydro_level_t block_level = read_stream_level();
+#if CONFIG_IDF_TARGET_LINUX
+        if(hydro_stream_ended()) {
+            hydro_replay_finish();
+        }
+#endif
+        int64_t now_ms = stream_time_us / 1000;
+#if CONFIG_HYDRO_HISTORY
+        record_history(probes.values[0], now_ms);
+#endif
+#if CONFIG_HYDRO_TREND
+        if(now_ms - last_trend_ms >= POLL_PERIOD_MS) {
+            last_trend_ms = now_ms;
+            update_trend(probes.values[0]);
+        }
+        block_level = escalate_for_trend(block_level);
+#endif
+#if CONFIG_IDF_TARGET_LINUX
+        hydro_replay_note_level(stream_time_us, block_level);
+#endif
+        if(block_level == sensor_level && now_ms - last_handled_ms < POLL_PERIOD_MS) {
+            continue;
+        }
+
+        last_handled_ms = now_ms;
+        sensor_level = block_level;
+        handle_sensor_level(sensor_level);
+    }
+#elif CONFIG_HYDRO_SENSOR_MODE_EVENT
+    hydro_threshold_event_t event;
+    read_stream_level();
+    sensor_level = primary_probe_level();
+#if CONFIG_IDF_TARGET_LINUX
+    hydro_replay_note_level(stream_time_us, sensor_level);
+#endif
+
+    while(true) {
+        handle_sensor_level(sensor_level);
+#if CONFIG_IDF_TARGET_LINUX
+        if(hydro_stream_ended()) {
+            hydro_replay_finish();
+        }
+#endif
         if(sensor_level == HYDRO_LEVEL_ERR) {
-            ESP_LOGI(TAG, "failed to read sensor");
-        } else {
-            ESP_LOGD(TAG, "sensor level: %d", sensor_level);
+            vTaskDelay(POLL_PERIOD_MS / portTICK_PERIOD_MS);
+            read_stream_level();
+            sensor_level = primary_probe_level();
+            continue;
+        }
 
-            buzzer_pattern_t* pattern = patterns[sensor_level];
-            if(pattern != NULL) {
-                buzzer_control_play_pattern(pattern);
-            }
+        int32_t low_mv, high_mv;
+        ESP_ERROR_CHECK(hydro_level_band(&probe_filter_config, sensor_level, &low_mv, &high_mv));
+        ESP_ERROR_CHECK(hydro_stream_arm_threshold(low_mv, high_mv));
 
-            if(sensor_level > HYDRO_LEVEL_OK) {
-                c3_blink_color(255, 0, 0, 400);
-            } else {
-                c3_stop_blink();
-            }
+        // While dry there is nothing to repeat, so only a crossing wakes the task.
+        TickType_t timeout = sensor_level > HYDRO_LEVEL_OK ? pdMS_TO_TICKS(POLL_PERIOD_MS) : portMAX_DELAY;
+        if(hydro_stream_wait_event(&event, timeout)) {
+            ESP_LOGD(TAG, "threshold crossed at %" PRId64 " us, %u mV", event.timestamp_us, event.mv);
+            sensor_level = confirm_crossing(&event, sensor_level);
+#if CONFIG_IDF_TARGET_LINUX
+            hydro_replay_note_level(stream_time_us, sensor_level);
+#endif
+        }
+    }
+#elif CONFIG_HYDRO_SENSOR_MODE_SLEEP
+    handle_sensor_level(sleep_state.reported_level);
+    vTaskDelay(POLL_PERIOD_MS / portTICK_PERIOD_MS);
+    enter_deep_sleep();
+#else
+    while(true) {
+        sensor_level = read_hydro_sensor();
+#if CONFIG_HYDRO_TREND
+        if(sensor_level != HYDRO_LEVEL_ERR) {
+            update_trend(read_hydro_sensor_filtered_mv());
+            sensor_level = escalate_for_trend(sensor_level);
+        }
+#endif
+        handle_sensor_level(sensor_level);
+#if CONFIG_HYDRO_HISTORY
+        if(sensor_level != HYDRO_LEVEL_ERR) {
+            record_history(read_hydro_sensor_filtered_mv(), (int64_t)xTaskGetTickCount() * portTICK_PERIOD_MS);
         }
+#endif
 
-        vTaskDelay(4000 / portTICK_PERIOD_MS);
+        vTaskDelay(POLL_PERIOD_MS / portTICK_PERIOD_MS);
     }
+#endif
 
     fflush(stdout);
     esp_restart();
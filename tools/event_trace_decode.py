@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Decode event_trace_dump() output from a serial log into readable text.
+
+Usage: event_trace_decode.py [LOG_FILE]   (reads stdin when no file is given)
+"""
+import os
+import re
+import struct
+import sys
+
+EVENT_HEADER = os.path.join(os.path.dirname(__file__), "..", "components", "event_trace", "include", "event_trace.h")
+EVENT_PATTERN = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+LINE_PATTERN = re.compile(r"ET:([0-9a-fA-F]{32})")
+# A dump never repeats more than one ring of records, this covers any CONFIG_EVENT_TRACE_RECORDS in use.
+MAX_RING_RECORDS = 65536
+
+
+def load_events(header_path):
+    with open(header_path) as header:
+        return EVENT_PATTERN.findall(header.read())
+
+
+def signed(value, bits):
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def format_event(fmt, arg16, arg32):
+    # %d arguments are stored two's complement in their unsigned slots.
+    specs = re.findall(r"%[-0-9]*([a-z])", fmt)
+    args = [arg16, arg32]
+    for idx, spec in enumerate(specs[:2]):
+        if spec == "d":
+            args[idx] = signed(args[idx], 16 if idx == 0 else 32)
+    return fmt % tuple(args[:len(specs)])
+
+
+def main():
+    events = load_events(EVENT_HEADER)
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    last_seq = None
+    # Timestamps of the records already printed by seq. Every dump prints the whole ring again, so the
+    # next one repeats records that were printed before.
+    printed = {}
+
+    for line in source:
+        match = LINE_PATTERN.search(line)
+        if match is None:
+            continue
+
+        seq, timestamp_us, event_id, arg16, arg32 = struct.unpack(">IIHHI", bytes.fromhex(match.group(1)))
+        if last_seq is not None and seq <= last_seq:
+            # Going backwards starts a new dump. Records it repeats are skipped, one that differs means
+            # the device restarted and its seq began again.
+            if printed.get(seq) == timestamp_us:
+                continue
+            print("-- trace restarted --")
+            printed.clear()
+            last_seq = None
+
+        if last_seq is not None and seq != last_seq + 1:
+            print("-- %d records lost --" % (seq - last_seq - 1))
+        last_seq = seq
+        printed[seq] = timestamp_us
+        if len(printed) > 2 * MAX_RING_RECORDS:
+            printed = {key: value for key, value in printed.items() if key > seq - MAX_RING_RECORDS}
+
+        if event_id < len(events):
+            name, fmt = events[event_id]
+            text = format_event(fmt, arg16, arg32)
+        else:
+            name, text = "UNKNOWN_%d" % event_id, "arg16=%u arg32=%u" % (arg16, arg32)
+
+        print("%10.6f %-20s %s" % (timestamp_us / 1e6, name, text))
+
+
+if __name__ == "__main__":
+    main()
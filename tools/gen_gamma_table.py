@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""Generate the LED gamma table header at build time.
+
+Usage: gen_gamma_table.py OUT_HEADER
+
+Maps a linear 8 bit intensity to the WS2812 PWM value that looks that bright, with a gamma of 2.8, so fades
+and level bars step evenly to the eye. Brightness is applied before the lookup and stays linear.
+"""
+import sys
+
+GAMMA = 2.8
+
+
+def gamma_table():
+    return [round(255 * (value / 255) ** GAMMA) for value in range(256)]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    values = gamma_table()
+    rows = []
+    for start in range(0, 256, 16):
+        rows.append("    " + ", ".join("%3d" % value for value in values[start:start + 16]) + ",")
+
+    with open(sys.argv[1], "w") as out:
+        out.write("// Generated by tools/gen_gamma_table.py, do not edit.\n"
+                  "#pragma once\n\n"
+                  "#include <stdint.h>\n\n"
+                  "static const uint8_t led_gamma[256] = {\n%s\n};\n"
+                  % "\n".join(rows))
+
+
+if __name__ == "__main__":
+    main()
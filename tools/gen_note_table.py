@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""Generate the buzzer note frequency header at build time.
+
+Usage: gen_note_table.py OUT_HEADER
+
+Equal temperament from A4 = 440 Hz, rounded to whole Hz, for octaves 0-8. Notes are indexed from C0 as
+semitone + octave * 12, so turning a parsed note into a keyframe frequency is one load.
+"""
+import sys
+
+OCTAVES = 9
+NOTE_COUNT = OCTAVES * 12
+A4_INDEX = 4 * 12 + 9
+A4_HZ = 440
+
+
+def note_frequencies():
+    return [round(A4_HZ * 2 ** ((idx - A4_INDEX) / 12)) for idx in range(NOTE_COUNT)]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    values = note_frequencies()
+    rows = []
+    for octave in range(OCTAVES):
+        row = values[octave * 12:(octave + 1) * 12]
+        rows.append("    " + ", ".join("%5d" % value for value in row) + ",")
+
+    with open(sys.argv[1], "w") as out:
+        out.write("// Generated by tools/gen_note_table.py, do not edit.\n"
+                  "#pragma once\n\n"
+                  "#include <stdint.h>\n\n"
+                  "#define BUZZER_NOTE_OCTAVES %d\n"
+                  "#define BUZZER_NOTE_COUNT %d\n\n"
+                  "static const uint16_t note_frequency_hz[BUZZER_NOTE_COUNT] = {\n%s\n};\n"
+                  % (OCTAVES, NOTE_COUNT, "\n".join(rows)))
+
+
+if __name__ == "__main__":
+    main()
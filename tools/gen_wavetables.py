@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""Generate the buzzer wavetable header at build time.
+
+Usage: gen_wavetables.py OUT_HEADER
+
+Each table is one period of signed 8 bit amplitudes, fed to the sigma-delta modulator as pulse density.
+"""
+import math
+import sys
+
+TABLE_BITS = 8
+TABLE_LEN = 1 << TABLE_BITS
+AMPLITUDE = 127
+
+
+def square(i):
+    return AMPLITUDE if i < TABLE_LEN // 2 else -AMPLITUDE
+
+
+def sine(i):
+    return round(AMPLITUDE * math.sin(2 * math.pi * i / TABLE_LEN))
+
+
+def saw(i):
+    return round(-AMPLITUDE + 2 * AMPLITUDE * i / (TABLE_LEN - 1))
+
+
+TABLES = [("wave_square", square), ("wave_sin", sine), ("wave_saw", saw)]
+
+
+def format_table(name, func):
+    values = [func(i) for i in range(TABLE_LEN)]
+    rows = []
+    for start in range(0, TABLE_LEN, 16):
+        rows.append("    " + ", ".join("%d" % value for value in values[start:start + 16]) + ",")
+    return "static const int8_t %s[BUZZER_WAVE_TABLE_LEN] = {\n%s\n};\n" % (name, "\n".join(rows))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    parts = [
+        "// Generated by tools/gen_wavetables.py, do not edit.\n"
+        "#pragma once\n\n"
+        "#include <stdint.h>\n\n"
+        "#define BUZZER_WAVE_TABLE_BITS %d\n"
+        "#define BUZZER_WAVE_TABLE_LEN %d\n" % (TABLE_BITS, TABLE_LEN),
+    ]
+    parts += [format_table(name, func) for name, func in TABLES]
+
+    with open(sys.argv[1], "w") as out:
+        out.write("\n".join(parts))
+
+
+if __name__ == "__main__":
+    main()
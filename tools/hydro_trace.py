@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Write hydro replay traces for the linux target build.
+
+Usage:
+  hydro_trace.py synth OUT_FILE [--hours H] [--rate HZ] [--channels N] [--seed S]
+  hydro_trace.py convert CSV_FILE OUT_FILE --rate HZ
+
+synth writes a dry baseline with noise, slow seeps and sudden wettings.
+convert packs a CSV with one scan of raw ADC values per line, '#' lines are skipped.
+Replay with: HYDRO_REPLAY_TRACE=OUT_FILE build/esp-leak-detector.elf
+"""
+import argparse
+import array
+import random
+import struct
+import sys
+
+MAGIC = 0x31545248
+RAW_MAX = 4095
+# Matches the nominal full scale hydro_cali uses on the linux target.
+FULL_SCALE_MV = 2500
+RAW_COUNT = 4096
+
+
+def raw_for_mv(mv):
+    return max(0, min(RAW_MAX, round(mv * RAW_COUNT / FULL_SCALE_MV)))
+
+
+def write_trace(path, rate, channel_count, values):
+    with open(path, "wb") as out:
+        out.write(struct.pack("<IIB3x", MAGIC, rate, channel_count))
+        if sys.byteorder != "little":
+            values.byteswap()
+        values.tofile(out)
+
+
+def synth(args):
+    rng = random.Random(args.seed)
+    scans = int(args.hours * 3600 * args.rate / args.channels)
+    values = array.array("H")
+
+    # Each episode ramps the probe from dry towards a wetter target and back, at its own pace.
+    events = []
+    t = rng.uniform(0.05, 0.2) * scans
+    while t < scans:
+        duration = rng.uniform(0.02, 0.08) * scans
+        ramp = rng.choice([0.001, 0.3]) * duration
+        events.append((int(t), int(ramp), int(duration), rng.choice([2000, 1600, 1100])))
+        t += duration + rng.uniform(0.1, 0.3) * scans
+
+    dry_mv = 2450
+    event_idx = 0
+    for scan in range(scans):
+        while event_idx < len(events) and scan >= events[event_idx][0] + events[event_idx][2]:
+            event_idx += 1
+        target = dry_mv
+        if event_idx < len(events) and scan >= events[event_idx][0]:
+            start, ramp, duration, wet_mv = events[event_idx]
+            progress = min(1.0, (scan - start) / max(1, ramp))
+            target = dry_mv + (wet_mv - dry_mv) * progress
+        for channel in range(args.channels):
+            # Only the first probe sees the leak, the others stay dry.
+            mv = target if channel == 0 else dry_mv
+            values.append(raw_for_mv(mv + rng.gauss(0, 8)))
+
+    write_trace(args.out, args.rate, args.channels, values)
+    print("%d scans, %d episodes" % (scans, len(events)))
+
+
+def convert(args):
+    values = array.array("H")
+    channel_count = None
+    with open(args.csv) as source:
+        for line in source:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            scan = [int(field) for field in line.split(",")]
+            if channel_count is None:
+                channel_count = len(scan)
+            elif len(scan) != channel_count:
+                sys.exit("every line needs %d values: %s" % (channel_count, line))
+            values.extend(min(RAW_MAX, max(0, value)) for value in scan)
+
+    if channel_count is None:
+        sys.exit("no samples in %s" % args.csv)
+    write_trace(args.out, args.rate, channel_count, values)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    synth_parser = commands.add_parser("synth")
+    synth_parser.add_argument("out")
+    synth_parser.add_argument("--hours", type=float, default=6)
+    synth_parser.add_argument("--rate", type=int, default=1000)
+    synth_parser.add_argument("--channels", type=int, default=1)
+    synth_parser.add_argument("--seed", type=int, default=1)
+    synth_parser.set_defaults(run=synth)
+
+    convert_parser = commands.add_parser("convert")
+    convert_parser.add_argument("csv")
+    convert_parser.add_argument("out")
+    convert_parser.add_argument("--rate", type=int, required=True)
+    convert_parser.set_defaults(run=convert)
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Compile buzzer music strings into const pattern tables at build time.
+
+Usage: mml_compile.py PATTERN_FILE OUT_HEADER
+
+Each non-comment line of PATTERN_FILE is "name waveform loop music", for example:
+    level_low  saw  once  o4l2cr2c
+
+Music follows the grammar in buzzer_music.h, parsed the same way as buzzer_music_parser_t, and the
+frequencies come from gen_note_table.py so both stay in step. Errors point at the offending
+character and fail the build.
+"""
+import os
+import re
+import sys
+
+from gen_note_table import OCTAVES, note_frequencies
+
+NAME_PATTERN = re.compile(r"[a-z_][a-z0-9_]*$")
+
+WAVEFORMS = {"square": "BUZZER_WAV_SQUARE", "sin": "BUZZER_WAV_SIN", "saw": "BUZZER_WAV_SAW"}
+LOOPS = {"loop": "true", "once": "false"}
+WHOLE_NOTE_OFFSETS = {"a": 9, "b": 11, "c": 0, "d": 2, "e": 4, "f": 5, "g": 7}
+
+
+MAX_NOTE_COUNT = 512
+MAX_OCTAVE = OCTAVES - 1
+MAX_NOTE_LEN = 64
+MIN_TEMPO = 16
+MAX_TEMPO = 960
+MAX_DIGITS = 4
+MAX_DOTS = 3
+MAX_REPEAT_DEPTH = 4
+COMMANDS = "abcdefgrolt]"
+
+
+class MusicError(Exception):
+    def __init__(self, message, idx):
+        super().__init__(message)
+        self.idx = idx
+
+
+class Parser:
+    """Mirrors buzzer_music_parser_t, down to the integer rounding, so compiled and parsed tunes match."""
+
+    def __init__(self, frequencies):
+        self.frequencies = frequencies
+        self.frames = []
+        self.tempo = 240
+        self.octave = 3
+        self.note_len = 1
+        self.repeats = []
+        self.cmd = None
+
+    def emit(self, frequency, duration):
+        if len(self.frames) == MAX_NOTE_COUNT:
+            raise MusicError("too many notes", self.cmd_pos)
+        self.frames.append((frequency, duration))
+
+    def duration_ms(self, sixteenths):
+        dotted = (2 << self.dots) - 1
+        return sixteenths * 15000 * dotted // (self.tempo << self.dots)
+
+    def finish_note(self, whole):
+        if whole in "cf" and self.modifier < 0:
+            raise MusicError("C and F flat are invalid", self.cmd_pos)
+        if whole in "eb" and self.modifier > 0:
+            raise MusicError("E and B sharp are invalid", self.cmd_pos)
+
+        length = self.value if self.digits else self.note_len
+        if not 1 <= length <= MAX_NOTE_LEN:
+            raise MusicError("note length must be 1-64", self.cmd_pos)
+        duration = self.duration_ms(length)
+        if duration > 0xFFFF:
+            raise MusicError("note too long for the tempo", self.cmd_pos)
+
+        note_idx = WHOLE_NOTE_OFFSETS[whole] + self.modifier + self.octave * 12
+        self.emit(self.frequencies[note_idx], duration)
+
+    def finish_repeat(self):
+        if not self.repeats:
+            raise MusicError("repeat end without a start", self.cmd_pos)
+        count = self.value if self.digits else 2
+        if count == 0:
+            raise MusicError("repeat count must be at least 1", self.cmd_pos)
+
+        block = self.frames[self.repeats.pop():]
+        if len(self.frames) + len(block) * (count - 1) > MAX_NOTE_COUNT:
+            raise MusicError("too many notes", self.cmd_pos)
+        self.frames.extend(block * (count - 1))
+
+    def finish_command(self):
+        cmd, self.cmd = self.cmd, None
+        if cmd in WHOLE_NOTE_OFFSETS:
+            return self.finish_note(cmd)
+        if self.dots and cmd != "r":
+            raise MusicError("dots only follow notes and rests", self.cmd_pos)
+        if cmd == "]":
+            return self.finish_repeat()
+        if not self.digits:
+            raise MusicError("command must have a number following it", self.cmd_pos)
+
+        value = self.value
+        if cmd == "r":
+            if not 1 <= value <= MAX_NOTE_LEN:
+                raise MusicError("rest length must be 1-64", self.cmd_pos)
+            duration = self.duration_ms(value * 2)
+            if duration > 0xFFFF:
+                raise MusicError("rest too long for the tempo", self.cmd_pos)
+            self.emit(0, duration)
+        elif cmd == "o":
+            if value > MAX_OCTAVE:
+                raise MusicError("octave must be 0-8", self.cmd_pos)
+            self.octave = value
+        elif cmd == "l":
+            if not 1 <= value <= MAX_NOTE_LEN:
+                raise MusicError("length must be 1-64", self.cmd_pos)
+            self.note_len = value
+        elif not MIN_TEMPO <= value <= MAX_TEMPO:
+            raise MusicError("tempo must be 16-960", self.cmd_pos)
+        else:
+            self.tempo = value
+
+    def feed(self, char, pos):
+        if self.cmd is not None:
+            if char.isdigit() and not self.dots:
+                if self.digits == MAX_DIGITS:
+                    raise MusicError("number too long", pos)
+                self.value = self.value * 10 + int(char)
+                self.digits += 1
+                return
+            if char == ".":
+                if self.dots == MAX_DOTS:
+                    raise MusicError("too many dots", pos)
+                self.dots += 1
+                return
+            if (self.cmd in WHOLE_NOTE_OFFSETS and char in "#$" and not self.modifier
+                    and not self.digits and not self.dots):
+                self.modifier = 1 if char == "#" else -1
+                return
+            self.finish_command()
+
+        if char in COMMANDS:
+            self.cmd, self.cmd_pos = char, pos
+            self.modifier = self.dots = self.digits = self.value = 0
+        elif char == "[":
+            if len(self.repeats) == MAX_REPEAT_DEPTH:
+                raise MusicError("repeats nested too deep", pos)
+            if not self.repeats:
+                self.repeat_pos = pos
+            self.repeats.append(len(self.frames))
+        elif char != " ":
+            raise MusicError("unexpected character", pos)
+
+    def finish(self):
+        if self.cmd is not None:
+            self.finish_command()
+        if self.repeats:
+            raise MusicError("repeat start without an end", self.repeat_pos)
+        if not self.frames:
+            raise MusicError("no notes", 0)
+        return self.frames
+
+
+def compile_music(music, frequencies):
+    parser = Parser(frequencies)
+    for pos, char in enumerate(music):
+        parser.feed(char, pos)
+    return parser.finish()
+
+
+def format_pattern(name, waveform, loop, frames):
+    rows = "\n".join("    { .frequency = %d, .duration = %d }," % frame for frame in frames)
+    return ("static const buzzer_keyframe_t %s_frames[] = {\n%s\n};\n\n"
+            "static const buzzer_pattern_t %s = {\n"
+            "    .loop = %s,\n"
+            "    .frame_count = %d,\n"
+            "    .waveform = %s,\n"
+            "    .key_frames = %s_frames,\n"
+            "};\n" % (name, rows, name, loop, len(frames), waveform, name))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    pattern_path, out_path = sys.argv[1:]
+    frequencies = note_frequencies()
+    parts = ["// Generated by tools/mml_compile.py from %s, do not edit.\n"
+             "#pragma once\n\n"
+             "#include \"buzzer_control.h\"\n" % os.path.basename(pattern_path)]
+
+    with open(pattern_path) as patterns:
+        for line_no, line in enumerate(patterns, 1):
+            # '#' is also the sharp sign, so only whole lines can be comments.
+            fields = line.split()
+            if not fields or fields[0].startswith("#"):
+                continue
+
+            where = "%s:%d" % (pattern_path, line_no)
+            if len(fields) != 4:
+                sys.exit("%s: expected \"name waveform loop music\"" % where)
+
+            name, waveform, loop, music = fields
+            if not NAME_PATTERN.match(name) or waveform not in WAVEFORMS or loop not in LOOPS:
+                sys.exit("%s: bad name, waveform (%s) or loop (%s)" % (where, "/".join(WAVEFORMS), "/".join(LOOPS)))
+
+            try:
+                frames = compile_music(music, frequencies)
+            except MusicError as err:
+                column = line.index(music) + err.idx
+                sys.exit("%s:%d: %s\n%s\n%*s" % (where, column + 1, err, line.rstrip(), column + 1, "^"))
+
+            parts.append(format_pattern(name, WAVEFORMS[waveform], LOOPS[loop], frames))
+
+    with open(out_path, "w") as out:
+        out.write("\n".join(parts))
+
+
+if __name__ == "__main__":
+    main()